@@ -1,6 +1,25 @@
 import pandas as pd
 import matplotlib.pyplot as plt
 import os
+import sqlite3
+
+# Paramètres du run: plot_params.txt, écrit avec client_delays.csv par le même run;
+# sinon le dernier run third4 de la base de résultats qui a mesuré des délais d'écho
+nWifi, nPackets = 4, 10
+if os.path.exists('plot_params.txt'):
+    with open('plot_params.txt') as f:
+        values = f.read().split()
+    nWifi, nPackets = int(values[0]), int(values[1])
+elif os.path.exists('results.db'):
+    con = sqlite3.connect('results.db')
+    rows = con.execute("SELECT p.name, p.value FROM run_params p JOIN runs r ON p.run_id = r.run_id "
+                       "WHERE r.run_id = (SELECT r2.run_id FROM runs r2 JOIN run_metrics m "
+                       "ON m.run_id = r2.run_id WHERE r2.scenario = 'third4' AND m.name = 'echoPackets' "
+                       "ORDER BY r2.started DESC, r2.rowid DESC LIMIT 1)").fetchall()
+    con.close()
+    params = dict(rows)
+    nWifi = int(params.get('nWifi', nWifi))
+    nPackets = int(params.get('nPackets', nPackets))
 
 if os.path.exists('client_delays.csv'):
     df = pd.read_csv('client_delays.csv')
@@ -8,9 +27,9 @@ if os.path.exists('client_delays.csv'):
     plt.plot(df['PacketNumber'], df['DelayMs'], 'bo-', linewidth=2, markersize=8)
     plt.xlabel('Numéro de paquet')
     plt.ylabel('Délai bout-en-bout (ms)')
-    plt.title('Délai requête-réponse en fonction du numéro de paquet\\n(' + str(4) + ' STA par réseau, ' + str(10) + ' paquets)')
+    plt.title('Délai requête-réponse en fonction du numéro de paquet\\n(' + str(nWifi) + ' STA par réseau, ' + str(nPackets) + ' paquets)')
     plt.grid(True, alpha=0.3)
-    plt.xticks(range(1, 11))
+    plt.xticks(range(1, nPackets + 1))
     plt.tight_layout()
     plt.savefig('delai_bout_en_bout.png', dpi=300)
     print('Graphique sauvegardé: delai_bout_en_bout.png')
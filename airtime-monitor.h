@@ -0,0 +1,341 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef AIRTIME_MONITOR_H
+#define AIRTIME_MONITOR_H
+
+#include "results-db.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy-state-helper.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-psdu.h"
+#include "ns3/wifi-remote-station-manager.h"
+
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Per-device and per-BSS airtime accounting driven by the Wi-Fi PHY State
+ * trace. Every device sums its time in TX, RX and CCA-busy (idle is the
+ * remainder). Each BSS also gets the channel utilization seen by its AP,
+ * as whole-run fractions and as periodic samples, the same quantity an
+ * AP advertises in the 802.11 BSS Load element. Retries are counted per
+ * station from the Retry bit of every transmitted data MPDU, which also
+ * covers MPDUs a BlockAck reported missing; failures and reception drops
+ * come from the remote station manager and PHY drop traces.
+ */
+class AirtimeMonitor
+{
+  public:
+    enum Airtime
+    {
+        AIRTIME_TX,
+        AIRTIME_RX,
+        AIRTIME_CCA_BUSY,
+        AIRTIME_OTHER, // switching, sleep, off
+        AIRTIME_STATES
+    };
+
+    struct Device
+    {
+        AirtimeMonitor* monitor;
+        std::string name;
+        std::string bss;
+        bool ap;
+        Time airtime[AIRTIME_STATES];
+        uint64_t txFrames;
+        uint64_t dataMpdus; // transmitted data MPDUs, aggregated or not
+        uint64_t retryMpdus; // those with the Retry bit set
+        uint64_t dataFailed;
+        uint64_t finalDataFailed;
+        uint64_t rxDrops;
+    };
+
+    /// Stations whose retry ratio exceeds this are flagged in the report
+    double retryThreshold = 0.1;
+
+    AirtimeMonitor(Time period)
+        : m_period(period)
+    {
+    }
+
+    ~AirtimeMonitor()
+    {
+        for (auto device : m_devices)
+        {
+            delete device;
+        }
+    }
+
+    void AddDevice(Ptr<NetDevice> netDevice, const std::string& name, const std::string& bss, bool ap)
+    {
+        Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice>(netDevice);
+        Device* device = new Device{this, name, bss, ap, {}, 0, 0, 0, 0, 0, 0};
+
+        wifiDevice->GetPhy()->GetState()->TraceConnectWithoutContext(
+            "State",
+            MakeBoundCallback(&AirtimeMonitor::StateTrace, device));
+        wifiDevice->GetPhy()->TraceConnectWithoutContext(
+            "PhyTxBegin",
+            MakeBoundCallback(&AirtimeMonitor::TxBeginTrace, device));
+        wifiDevice->GetPhy()->TraceConnectWithoutContext(
+            "PhyTxPsduBegin",
+            MakeBoundCallback(&AirtimeMonitor::TxPsduBeginTrace, device));
+        wifiDevice->GetPhy()->TraceConnectWithoutContext(
+            "PhyRxDrop",
+            MakeBoundCallback(&AirtimeMonitor::RxDropTrace, device));
+        wifiDevice->GetRemoteStationManager()->TraceConnectWithoutContext(
+            "MacTxDataFailed",
+            MakeBoundCallback(&AirtimeMonitor::DataFailedTrace, device));
+        wifiDevice->GetRemoteStationManager()->TraceConnectWithoutContext(
+            "MacTxFinalDataFailed",
+            MakeBoundCallback(&AirtimeMonitor::FinalDataFailedTrace, device));
+
+        m_devices.push_back(device);
+        m_samples[bss];
+    }
+
+    void AddDevices(const NetDeviceContainer& devices, const std::string& prefix, const std::string& bss, bool ap)
+    {
+        for (uint32_t i = 0; i < devices.GetN(); ++i)
+        {
+            AddDevice(devices.Get(i),
+                      prefix + "-" + std::to_string(devices.Get(i)->GetNode()->GetId()),
+                      bss,
+                      ap);
+        }
+    }
+
+    /// Fraction of the elapsed time a device spent in a state
+    double Fraction(const Device* device, Airtime state) const
+    {
+        double elapsed = Simulator::Now().GetSeconds();
+        return elapsed > 0 ? device->airtime[state].GetSeconds() / elapsed : 0.0;
+    }
+
+    /// Fraction of the elapsed time the AP of a BSS saw the channel busy (TX, RX or CCA-busy)
+    double Utilization(const std::string& bss) const
+    {
+        for (const Device* device : m_devices)
+        {
+            if (device->ap && device->bss == bss)
+            {
+                return Fraction(device, AIRTIME_TX) + Fraction(device, AIRTIME_RX) +
+                       Fraction(device, AIRTIME_CCA_BUSY);
+            }
+        }
+        return 0.0;
+    }
+
+    /// Retransmitted data MPDUs over transmitted data MPDUs; beacons and control frames are left out
+    double RetryRatio(const Device* device) const
+    {
+        return device->dataMpdus > 0 ? double(device->retryMpdus) / device->dataMpdus : 0.0;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        os << "\n=== OCCUPATION DU CANAL ===" << std::endl;
+        for (const auto& bss : m_samples)
+        {
+            os << bss.first << ": utilisation du canal (vue de l'AP) " << Utilization(bss.first) * 100
+               << "%" << std::endl;
+            for (const Device* device : m_devices)
+            {
+                if (device->bss != bss.first)
+                {
+                    continue;
+                }
+                os << "  " << device->name << ": TX " << Fraction(device, AIRTIME_TX) * 100
+                   << "%, RX " << Fraction(device, AIRTIME_RX) * 100 << "%, CCA "
+                   << Fraction(device, AIRTIME_CCA_BUSY) * 100 << "%, idle "
+                   << (1.0 - Fraction(device, AIRTIME_TX) - Fraction(device, AIRTIME_RX) -
+                       Fraction(device, AIRTIME_CCA_BUSY) - Fraction(device, AIRTIME_OTHER)) *
+                          100
+                   << "% | trames " << device->txFrames << ", MPDU de données " << device->dataMpdus
+                   << " (réémis " << device->retryMpdus << "), échecs " << device->dataFailed
+                   << " (abandons " << device->finalDataFailed << "), rx perdues "
+                   << device->rxDrops;
+                if (RetryRatio(device) > retryThreshold)
+                {
+                    os << "  <-- retransmissions " << RetryRatio(device) * 100 << "%";
+                }
+                os << std::endl;
+            }
+        }
+    }
+
+    /// Periodic AP-view utilization samples, one row per BSS and period
+    void ExportSamples(const std::string& filename) const
+    {
+        std::ofstream outFile(filename);
+        outFile << "Bss,TimeS,TxFraction,RxFraction,CcaBusyFraction,Utilization\n";
+        for (const auto& bss : m_samples)
+        {
+            for (uint32_t i = 0; i < bss.second.size(); ++i)
+            {
+                const Sample& sample = bss.second[i];
+                double period = m_period.GetSeconds();
+                outFile << bss.first << "," << (i + 1) * period << ","
+                        << sample.airtime[AIRTIME_TX] / period << ","
+                        << sample.airtime[AIRTIME_RX] / period << ","
+                        << sample.airtime[AIRTIME_CCA_BUSY] / period << ","
+                        << (sample.airtime[AIRTIME_TX] + sample.airtime[AIRTIME_RX] +
+                            sample.airtime[AIRTIME_CCA_BUSY]) /
+                               period
+                        << "\n";
+            }
+        }
+        outFile.close();
+    }
+
+    void Record(ResultsDb& results) const
+    {
+        for (const auto& bss : m_samples)
+        {
+            results.AddMetric("utilization." + bss.first, Utilization(bss.first));
+            for (uint32_t i = 0; i < bss.second.size(); ++i)
+            {
+                const Sample& sample = bss.second[i];
+                results.AddSample("utilization." + bss.first,
+                                  (i + 1) * m_period.GetSeconds(),
+                                  (sample.airtime[AIRTIME_TX] + sample.airtime[AIRTIME_RX] +
+                                   sample.airtime[AIRTIME_CCA_BUSY]) /
+                                      m_period.GetSeconds());
+            }
+        }
+        for (const Device* device : m_devices)
+        {
+            results.AddMetric("airtime." + device->name + ".tx", Fraction(device, AIRTIME_TX));
+            results.AddMetric("airtime." + device->name + ".rx", Fraction(device, AIRTIME_RX));
+            results.AddMetric("airtime." + device->name + ".ccaBusy", Fraction(device, AIRTIME_CCA_BUSY));
+            results.AddMetric("airtime." + device->name + ".retryRatio", RetryRatio(device));
+            results.AddMetric("airtime." + device->name + ".rxDrops", device->rxDrops);
+        }
+    }
+
+    const std::vector<Device*>& GetDevices() const
+    {
+        return m_devices;
+    }
+
+  private:
+    struct Sample
+    {
+        double airtime[AIRTIME_STATES] = {};
+    };
+
+    static void StateTrace(Device* device, Time start, Time duration, WifiPhyState state)
+    {
+        Airtime airtime;
+        switch (state)
+        {
+        case WifiPhyState::IDLE:
+            return;
+        case WifiPhyState::TX:
+            airtime = AIRTIME_TX;
+            break;
+        case WifiPhyState::RX:
+            airtime = AIRTIME_RX;
+            break;
+        case WifiPhyState::CCA_BUSY:
+            airtime = AIRTIME_CCA_BUSY;
+            break;
+        default:
+            airtime = AIRTIME_OTHER;
+            break;
+        }
+        device->airtime[airtime] += duration;
+        if (device->ap)
+        {
+            device->monitor->AddSample(device->bss, start, duration, airtime);
+        }
+    }
+
+    static void TxBeginTrace(Device* device, Ptr<const Packet> packet, double txPowerW)
+    {
+        device->txFrames++;
+    }
+
+    static void TxPsduBeginTrace(Device* device, WifiConstPsduMap psdus, WifiTxVector txVector, double txPowerW)
+    {
+        for (const auto& psdu : psdus)
+        {
+            for (std::size_t i = 0; i < psdu.second->GetNMpdus(); ++i)
+            {
+                const WifiMacHeader& header = psdu.second->GetHeader(i);
+                if (header.IsData())
+                {
+                    device->dataMpdus++;
+                    if (header.IsRetry())
+                    {
+                        device->retryMpdus++;
+                    }
+                }
+            }
+        }
+    }
+
+    static void RxDropTrace(Device* device, Ptr<const Packet> packet, WifiPhyRxfailureReason reason)
+    {
+        device->rxDrops++;
+    }
+
+    static void DataFailedTrace(Device* device, Mac48Address address)
+    {
+        device->dataFailed++;
+    }
+
+    static void FinalDataFailedTrace(Device* device, Mac48Address address)
+    {
+        device->finalDataFailed++;
+    }
+
+    /// Spread a state interval over the sampling periods it overlaps
+    void AddSample(const std::string& bss, Time start, Time duration, Airtime airtime)
+    {
+        std::vector<Sample>& samples = m_samples[bss];
+        Time end = start + duration;
+        while (start < end)
+        {
+            uint64_t index = start.GetNanoSeconds() / m_period.GetNanoSeconds();
+            Time periodEnd = m_period * (index + 1);
+            Time chunk = std::min(end, periodEnd) - start;
+            if (samples.size() <= index)
+            {
+                samples.resize(index + 1);
+            }
+            samples[index].airtime[airtime] += chunk.GetSeconds();
+            start += chunk;
+        }
+    }
+
+    Time m_period;
+    std::vector<Device*> m_devices;
+    std::map<std::string, std::vector<Sample>> m_samples;
+};
+
+} // namespace ns3
+
+#endif /* AIRTIME_MONITOR_H */
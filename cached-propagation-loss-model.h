@@ -0,0 +1,191 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CACHED_PROPAGATION_LOSS_MODEL_H
+#define CACHED_PROPAGATION_LOSS_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <set>
+#include <utility>
+
+namespace ns3
+{
+
+/**
+ * Memoizes the loss of a deterministic propagation loss model per
+ * (tx, rx) pair of mobility models. Only pairs whose two nodes are at rest
+ * are cached: a node moving at constant velocity changes position without
+ * notifying anyone. A cached entry is dropped when either node fires its
+ * CourseChange trace. Stochastic models (fading) go after this one with
+ * SetNext() and are still drawn for every frame.
+ */
+class CachedPropagationLossModel : public PropagationLossModel
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::CachedPropagationLossModel")
+                                .SetParent<PropagationLossModel>()
+                                .SetGroupName("Propagation")
+                                .AddConstructor<CachedPropagationLossModel>();
+        return tid;
+    }
+
+    /// One hit in this many is timed; misses are rare and always timed
+    static const uint64_t HIT_TIMING_SAMPLE = 64;
+
+    CachedPropagationLossModel()
+        : m_hits(0),
+          m_misses(0),
+          m_invalidations(0),
+          m_timedHits(0),
+          m_hitNs(0),
+          m_missNs(0)
+    {
+    }
+
+    /// Set the deterministic model whose loss is cached; it must not have a next model
+    void SetModel(Ptr<PropagationLossModel> model)
+    {
+        m_model = model;
+        m_cache.clear();
+    }
+
+    void PrintStats(std::ostream& os) const
+    {
+        uint64_t lookups = m_hits + m_misses;
+        double hitCost = m_timedHits > 0 ? double(m_hitNs) / m_timedHits : 0.0;
+        double missCost = m_misses > 0 ? double(m_missNs) / m_misses : 0.0;
+        os << "Path-loss cache: " << m_hits << " hits / " << lookups << " lookups ("
+           << (lookups > 0 ? m_hits * 100.0 / lookups : 0.0) << "%), " << m_invalidations
+           << " invalidations" << std::endl;
+        os << "  cost per frame: " << hitCost << " ns cached vs " << missCost
+           << " ns computed, ~" << (missCost - hitCost) * m_hits / 1e6 << " ms saved" << std::endl;
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_model = nullptr;
+        m_cache.clear();
+        PropagationLossModel::DoDispose();
+    }
+
+  private:
+    typedef std::pair<const MobilityModel*, const MobilityModel*> Link;
+
+    double DoCalcRxPower(double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         Ptr<MobilityModel> b) const override
+    {
+        // two clock reads cost about as much as the log10 a hit saves: time a sample only
+        bool timed = m_hits % HIT_TIMING_SAMPLE == 0;
+        std::chrono::steady_clock::time_point start;
+        if (timed)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+
+        Link link(PeekPointer(a), PeekPointer(b));
+        auto it = m_cache.find(link);
+        if (it != m_cache.end())
+        {
+            if (timed)
+            {
+                m_hitNs += Elapsed(start);
+                m_timedHits++;
+            }
+            m_hits++;
+            return txPowerDbm - it->second;
+        }
+
+        // only the model itself: IsStatic() hooks CourseChange once per mobility model
+        start = std::chrono::steady_clock::now();
+        double rxPowerDbm = m_model->CalcRxPower(txPowerDbm, a, b);
+        m_missNs += Elapsed(start);
+        m_misses++;
+
+        if (IsStatic(a) && IsStatic(b))
+        {
+            m_cache[link] = txPowerDbm - rxPowerDbm;
+        }
+        return rxPowerDbm;
+    }
+
+    int64_t DoAssignStreams(int64_t stream) override
+    {
+        return m_model->AssignStreams(stream);
+    }
+
+    bool IsStatic(Ptr<MobilityModel> mobility) const
+    {
+        if (m_watched.insert(PeekPointer(mobility)).second)
+        {
+            mobility->TraceConnectWithoutContext(
+                "CourseChange",
+                MakeCallback(&CachedPropagationLossModel::CourseChanged,
+                             const_cast<CachedPropagationLossModel*>(this)));
+        }
+        Vector velocity = mobility->GetVelocity();
+        return velocity.x == 0 && velocity.y == 0 && velocity.z == 0;
+    }
+
+    void CourseChanged(Ptr<const MobilityModel> mobility)
+    {
+        const MobilityModel* node = PeekPointer(mobility);
+        for (auto it = m_cache.begin(); it != m_cache.end();)
+        {
+            if (it->first.first == node || it->first.second == node)
+            {
+                it = m_cache.erase(it);
+                m_invalidations++;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    static uint64_t Elapsed(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    Ptr<PropagationLossModel> m_model;
+    mutable std::map<Link, double> m_cache;
+    mutable std::set<const MobilityModel*> m_watched;
+
+    mutable uint64_t m_hits;
+    mutable uint64_t m_misses;
+    uint64_t m_invalidations;
+    mutable uint64_t m_timedHits;
+    mutable uint64_t m_hitNs;
+    mutable uint64_t m_missNs;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(CachedPropagationLossModel);
+
+} // namespace ns3
+
+#endif /* CACHED_PROPAGATION_LOSS_MODEL_H */
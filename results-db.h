@@ -0,0 +1,357 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RESULTS_DB_H
+#define RESULTS_DB_H
+
+#include "ns3/core-module.h"
+#include "ns3/sqlite-output.h"
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <ostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Appends one record per simulation run to a local SQLite database so that
+ * sweeps can be compared with SQL instead of parsing stdout. A run is
+ * identified by a text run id; its parameters, summary metrics, per-flow
+ * metrics and time series go to separate tables keyed by that id:
+ *
+ *   runs(run_id, scenario, started, seed, run, revision, wall_seconds, sim_seconds)
+ *   run_params(run_id, name, value)
+ *   run_metrics(run_id, name, value)
+ *   flow_metrics(run_id, flow, name, value)
+ *   timeseries(run_id, series, x, value)
+ *
+ * Everything is buffered in memory and written in a single transaction by
+ * Commit(), so the database is only touched once per run.
+ */
+class ResultsDb
+{
+  public:
+    ResultsDb(const std::string& scenario, const std::string& sourceFile)
+        : m_scenario(scenario),
+          m_revision(ReadRevision(sourceFile)),
+          m_wallStart(std::chrono::steady_clock::now())
+    {
+        std::time_t now = std::time(nullptr);
+        char started[32];
+        std::strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        m_started = started;
+
+        // runs of a parallel sweep start in the same second with the same seed:
+        // the pid and a sub-second suffix keep their ids apart
+        std::ostringstream runId;
+        runId << scenario << "-" << now << "-" << RngSeedManager::GetSeed() << "-"
+              << RngSeedManager::GetRun() << "-" << getpid() << "-"
+              << std::hex << std::random_device()() << std::dec;
+        m_runId = runId.str();
+    }
+
+    const std::string& GetRunId() const
+    {
+        return m_runId;
+    }
+
+    template <typename T>
+    void AddParam(const std::string& name, const T& value)
+    {
+        std::ostringstream oss;
+        oss << value;
+        m_params.emplace_back(name, oss.str());
+    }
+
+    void AddMetric(const std::string& name, double value)
+    {
+        m_metrics.emplace_back(name, value);
+    }
+
+    void AddFlowMetric(const std::string& flow, const std::string& name, double value)
+    {
+        m_flowMetrics.emplace_back(flow, name, value);
+    }
+
+    void AddSample(const std::string& series, double x, double value)
+    {
+        m_samples.emplace_back(series, x, value);
+    }
+
+    /// Write the run to the database at path; returns false, and writes nothing, if any statement failed
+    bool Commit(const std::string& path)
+    {
+        double wallSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+
+        Ptr<SQLiteOutput> db = Create<SQLiteOutput>(path);
+        bool ok = CreateTables(db);
+        if (!ok)
+        {
+            return false;
+        }
+
+        ok &= db->SpinExec("BEGIN TRANSACTION;");
+
+        sqlite3_stmt* stmt;
+        db->SpinPrepare(&stmt, "INSERT INTO runs VALUES (?, ?, ?, ?, ?, ?, ?, ?);");
+        db->Bind(stmt, 1, m_runId);
+        db->Bind(stmt, 2, m_scenario);
+        db->Bind(stmt, 3, m_started);
+        db->Bind(stmt, 4, static_cast<uint32_t>(RngSeedManager::GetSeed()));
+        db->Bind(stmt, 5, static_cast<uint32_t>(RngSeedManager::GetRun()));
+        db->Bind(stmt, 6, m_revision);
+        db->Bind(stmt, 7, wallSeconds);
+        db->Bind(stmt, 8, Simulator::Now().GetSeconds());
+        ok &= db->SpinExec(stmt);
+
+        for (const auto& param : m_params)
+        {
+            db->SpinPrepare(&stmt, "INSERT INTO run_params VALUES (?, ?, ?);");
+            db->Bind(stmt, 1, m_runId);
+            db->Bind(stmt, 2, param.first);
+            db->Bind(stmt, 3, param.second);
+            ok &= db->SpinExec(stmt);
+        }
+
+        for (const auto& metric : m_metrics)
+        {
+            db->SpinPrepare(&stmt, "INSERT INTO run_metrics VALUES (?, ?, ?);");
+            db->Bind(stmt, 1, m_runId);
+            db->Bind(stmt, 2, metric.first);
+            db->Bind(stmt, 3, metric.second);
+            ok &= db->SpinExec(stmt);
+        }
+
+        for (const auto& metric : m_flowMetrics)
+        {
+            db->SpinPrepare(&stmt, "INSERT INTO flow_metrics VALUES (?, ?, ?, ?);");
+            db->Bind(stmt, 1, m_runId);
+            db->Bind(stmt, 2, std::get<0>(metric));
+            db->Bind(stmt, 3, std::get<1>(metric));
+            db->Bind(stmt, 4, std::get<2>(metric));
+            ok &= db->SpinExec(stmt);
+        }
+
+        for (const auto& sample : m_samples)
+        {
+            db->SpinPrepare(&stmt, "INSERT INTO timeseries VALUES (?, ?, ?, ?);");
+            db->Bind(stmt, 1, m_runId);
+            db->Bind(stmt, 2, std::get<0>(sample));
+            db->Bind(stmt, 3, std::get<1>(sample));
+            db->Bind(stmt, 4, std::get<2>(sample));
+            ok &= db->SpinExec(stmt);
+        }
+
+        // a run is written whole or not at all
+        if (!ok)
+        {
+            db->SpinExec("ROLLBACK;");
+            return false;
+        }
+        return db->SpinExec("END TRANSACTION;");
+    }
+
+    /**
+     * Look up the latest earlier run of this scenario whose parameters equal
+     * ours, except the names in ignored and the names in overrides, which
+     * must have the given values instead. Returns false if no such run
+     * recorded metric; otherwise fills its value and run id.
+     */
+    bool FindMatchingRun(const std::string& path,
+                         const std::map<std::string, std::string>& overrides,
+                         const std::set<std::string>& ignored,
+                         const std::string& metric,
+                         double& value,
+                         std::string& runId) const
+    {
+        std::map<std::string, std::string> wanted;
+        for (const auto& param : m_params)
+        {
+            if (ignored.count(param.first) == 0)
+            {
+                wanted[param.first] = param.second;
+            }
+        }
+        for (const auto& param : overrides)
+        {
+            wanted[param.first] = param.second;
+        }
+
+        Ptr<SQLiteOutput> db = Create<SQLiteOutput>(path);
+        if (!CreateTables(db))
+        {
+            return false;
+        }
+
+        // candidate runs, newest first, with the metric they recorded
+        std::vector<std::pair<std::string, double>> candidates;
+        sqlite3_stmt* stmt;
+        db->SpinPrepare(&stmt,
+                        "SELECT r.run_id, m.value FROM runs r JOIN run_metrics m "
+                        "ON m.run_id = r.run_id WHERE r.scenario = ? AND m.name = ? "
+                        "ORDER BY r.started DESC, r.rowid DESC;");
+        db->Bind(stmt, 1, m_scenario);
+        db->Bind(stmt, 2, metric);
+        while (db->SpinStep(stmt) == SQLITE_ROW)
+        {
+            candidates.emplace_back(
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)),
+                sqlite3_column_double(stmt, 1));
+        }
+        db->SpinFinalize(stmt);
+
+        for (const auto& candidate : candidates)
+        {
+            std::map<std::string, std::string> params;
+            db->SpinPrepare(&stmt, "SELECT name, value FROM run_params WHERE run_id = ?;");
+            db->Bind(stmt, 1, candidate.first);
+            while (db->SpinStep(stmt) == SQLITE_ROW)
+            {
+                std::string name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                if (ignored.count(name) == 0)
+                {
+                    params[name] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+                }
+            }
+            db->SpinFinalize(stmt);
+
+            if (params == wanted)
+            {
+                value = candidate.second;
+                runId = candidate.first;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Compare a metric of this run with the latest earlier run that differs
+     * only by param = baseline: print "label: ratio" to os and record the
+     * ratio as ratioMetric. Parameters that only exist on one side of the
+     * comparison are not matched: those that depend on param, and the flow
+     * monitoring settings unless they are what is being compared. Returns
+     * false if there is no such run.
+     */
+    bool CompareWithRun(const std::string& path,
+                        const std::string& param,
+                        const std::string& baseline,
+                        const std::string& metric,
+                        double value,
+                        const std::string& ratioMetric,
+                        const std::string& label,
+                        std::ostream& os)
+    {
+        static const std::map<std::string, std::set<std::string>> dependent = {
+            {"transport", {"tcpCc"}},
+            {"flowMonitor", {"flowSampling", "flowTopK"}}};
+        static const std::set<std::string> monitoring = {"flowMonitor", "flowSampling", "flowTopK"};
+
+        std::set<std::string> ignored;
+        auto it = dependent.find(param);
+        if (it != dependent.end())
+        {
+            ignored = it->second;
+        }
+        if (monitoring.count(param) == 0)
+        {
+            ignored.insert(monitoring.begin(), monitoring.end());
+        }
+
+        double baselineValue;
+        std::string runId;
+        if (path.empty() ||
+            !FindMatchingRun(path, {{param, baseline}}, ignored, metric, baselineValue, runId) ||
+            baselineValue <= 0)
+        {
+            os << label << ": aucun run " << param << "=" << baseline << " de même configuration"
+               << (path.empty() ? "" : " dans " + path) << std::endl;
+            return false;
+        }
+
+        double ratio = value / baselineValue;
+        os << label << ": " << ratio << " (" << param << "=" << baseline << ": " << baselineValue
+           << ", run " << runId << ")" << std::endl;
+        AddMetric(ratioMetric, ratio);
+        return true;
+    }
+
+  private:
+    static bool CreateTables(Ptr<SQLiteOutput> db)
+    {
+        bool ok = db->SpinExec("CREATE TABLE IF NOT EXISTS runs (run_id TEXT PRIMARY KEY, "
+                               "scenario TEXT, started TEXT, seed INTEGER, run INTEGER, "
+                               "revision TEXT, wall_seconds REAL, sim_seconds REAL);");
+        ok &= db->SpinExec("CREATE TABLE IF NOT EXISTS run_params (run_id TEXT, name TEXT, "
+                           "value TEXT);");
+        ok &= db->SpinExec("CREATE TABLE IF NOT EXISTS run_metrics (run_id TEXT, name TEXT, "
+                           "value REAL);");
+        ok &= db->SpinExec("CREATE TABLE IF NOT EXISTS flow_metrics (run_id TEXT, flow TEXT, "
+                           "name TEXT, value REAL);");
+        ok &= db->SpinExec("CREATE TABLE IF NOT EXISTS timeseries (run_id TEXT, series TEXT, "
+                           "x REAL, value REAL);");
+        return ok;
+    }
+
+    /// Revision of the tree holding sourceFile, "unknown" outside of a git checkout
+    static std::string ReadRevision(const std::string& sourceFile)
+    {
+        std::string dir = sourceFile.substr(0, sourceFile.find_last_of('/') + 1);
+        std::string cmd = "git -C \"" + (dir.empty() ? std::string(".") : dir) +
+                          "\" describe --always --dirty 2>/dev/null";
+        std::string revision;
+        FILE* pipe = popen(cmd.c_str(), "r");
+        if (pipe)
+        {
+            char buffer[128];
+            while (fgets(buffer, sizeof(buffer), pipe))
+            {
+                revision += buffer;
+            }
+            pclose(pipe);
+        }
+        while (!revision.empty() && (revision.back() == '\n' || revision.back() == '\r'))
+        {
+            revision.pop_back();
+        }
+        return revision.empty() ? "unknown" : revision;
+    }
+
+    std::string m_scenario;
+    std::string m_revision;
+    std::string m_started;
+    std::string m_runId;
+    std::chrono::steady_clock::time_point m_wallStart;
+
+    std::vector<std::pair<std::string, std::string>> m_params;
+    std::vector<std::pair<std::string, double>> m_metrics;
+    std::vector<std::tuple<std::string, std::string, double>> m_flowMetrics;
+    std::vector<std::tuple<std::string, double, double>> m_samples;
+};
+
+} // namespace ns3
+
+#endif /* RESULTS_DB_H */
@@ -0,0 +1,368 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SAMPLED_FLOW_MONITOR_H
+#define SAMPLED_FLOW_MONITOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <unordered_map>
+
+namespace ns3
+{
+
+/**
+ * Lightweight replacement for FlowMonitorHelper::InstallAll() in large
+ * scenarios. Probes are attached only to flow endpoints: SendOutgoing on
+ * the sender and LocalDeliver on the receiver, with nothing on APs or
+ * routers. One packet in N is sampled, and the choice is a hash of the
+ * packet uid, so a packet is sampled at both ends or at neither. Counts
+ * and delay sums are scaled by N, which keeps the estimates unbiased. At
+ * most K flows are tracked. When the table is full, the flow with the
+ * fewest sampled packets is evicted and the new flow inherits its count
+ * (Space-Saving), so heavy hitters are retained. Send times of sampled
+ * packets that are never delivered to a probed node (lost, evicted flow,
+ * unprobed receiver) are dropped once older than maxDelay.
+ *
+ * Results are returned as FlowMonitor::FlowStats and
+ * Ipv4FlowClassifier::FiveTuple, so reporting code does not depend on the
+ * monitor used.
+ */
+class SampledFlowMonitor
+{
+  public:
+    SampledFlowMonitor(uint32_t samplingRate, uint32_t maxFlows, Time maxDelay = Seconds(10))
+        : m_samplingRate(samplingRate == 0 ? 1 : samplingRate),
+          m_maxFlows(maxFlows),
+          m_maxDelay(maxDelay),
+          m_nextFlowId(1),
+          m_purgeSize(PURGE_MIN_SIZE),
+          m_probeEvents(0),
+          m_sampledPackets(0),
+          m_evictions(0)
+    {
+    }
+
+    /// Attach the sender and receiver probes to the IPv4 stack of each node
+    void Install(const NodeContainer& nodes)
+    {
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            Ptr<Ipv4L3Protocol> ipv4 = nodes.Get(i)->GetObject<Ipv4L3Protocol>();
+            ipv4->TraceConnectWithoutContext(
+                "SendOutgoing",
+                MakeCallback(&SampledFlowMonitor::SendOutgoing, this));
+            ipv4->TraceConnectWithoutContext(
+                "LocalDeliver",
+                MakeCallback(&SampledFlowMonitor::LocalDeliver, this));
+        }
+    }
+
+    /// Estimated per-flow statistics, scaled by the sampling rate
+    FlowMonitor::FlowStatsContainer GetFlowStats() const
+    {
+        FlowMonitor::FlowStatsContainer stats;
+        for (const auto& entry : m_flows)
+        {
+            const Flow& flow = entry.second;
+            FlowMonitor::FlowStats& s = stats[flow.id];
+            s.timeFirstTxPacket = flow.firstTx;
+            s.timeLastTxPacket = flow.lastTx;
+            s.timeFirstRxPacket = flow.firstRx;
+            s.timeLastRxPacket = flow.lastRx;
+            s.txPackets = flow.txPackets * m_samplingRate;
+            s.rxPackets = flow.rxPackets * m_samplingRate;
+            s.txBytes = flow.txBytes * m_samplingRate;
+            s.rxBytes = flow.rxBytes * m_samplingRate;
+            s.delaySum = flow.delaySum * m_samplingRate;
+            s.lostPackets =
+                flow.txPackets > flow.rxPackets ? (flow.txPackets - flow.rxPackets) * m_samplingRate : 0;
+            s.timesForwarded = 0;
+        }
+        return stats;
+    }
+
+    /// Five-tuple of every tracked flow, by flow id
+    std::map<FlowId, Ipv4FlowClassifier::FiveTuple> GetFlowTuples() const
+    {
+        std::map<FlowId, Ipv4FlowClassifier::FiveTuple> tuples;
+        for (const auto& entry : m_flows)
+        {
+            Ipv4FlowClassifier::FiveTuple& tuple = tuples[entry.second.id];
+            tuple.sourceAddress = Ipv4Address(std::get<0>(entry.first));
+            tuple.destinationAddress = Ipv4Address(std::get<1>(entry.first));
+            tuple.protocol = std::get<2>(entry.first);
+            tuple.sourcePort = std::get<3>(entry.first);
+            tuple.destinationPort = std::get<4>(entry.first);
+        }
+        return tuples;
+    }
+
+    uint64_t GetProbeEvents() const
+    {
+        return m_probeEvents;
+    }
+
+    void PrintStats(std::ostream& os) const
+    {
+        os << "Flow probes (endpoints only): " << m_probeEvents << " events, " << m_sampledPackets
+           << " sampled (1/" << m_samplingRate << "), " << m_flows.size() << " flows tracked";
+        if (m_maxFlows > 0)
+        {
+            os << " (max " << m_maxFlows << ", " << m_evictions << " evictions)";
+        }
+        os << std::endl;
+    }
+
+  private:
+    static constexpr size_t PURGE_MIN_SIZE = 1024;
+
+    // (source, destination, protocol, source port, destination port)
+    typedef std::tuple<uint32_t, uint32_t, uint8_t, uint16_t, uint16_t> FlowKey;
+
+    struct SendRecord
+    {
+        Time time;
+        FlowKey key;
+        FlowId id;
+    };
+
+    struct Flow
+    {
+        FlowId id;
+        uint64_t count; // sampled packets, plus the count inherited on eviction
+        uint64_t txPackets = 0;
+        uint64_t rxPackets = 0;
+        uint64_t txBytes = 0;
+        uint64_t rxBytes = 0;
+        Time delaySum;
+        Time firstTx;
+        Time lastTx;
+        Time firstRx;
+        Time lastRx;
+    };
+
+    bool Sampled(Ptr<const Packet> packet) const
+    {
+        uint32_t hash = static_cast<uint32_t>(packet->GetUid() * 2654435761u);
+        return m_samplingRate == 1 || (hash >> 8) % m_samplingRate == 0;
+    }
+
+    static FlowKey Classify(const Ipv4Header& header, Ptr<const Packet> packet)
+    {
+        uint16_t sourcePort = 0;
+        uint16_t destinationPort = 0;
+        if (header.GetFragmentOffset() == 0 && packet->GetSize() >= 4)
+        {
+            // UDP and TCP both start with the source and destination ports
+            uint8_t ports[4];
+            packet->CopyData(ports, 4);
+            if (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER ||
+                header.GetProtocol() == TcpL4Protocol::PROT_NUMBER)
+            {
+                sourcePort = (ports[0] << 8) | ports[1];
+                destinationPort = (ports[2] << 8) | ports[3];
+            }
+        }
+        return FlowKey(header.GetSource().Get(),
+                       header.GetDestination().Get(),
+                       header.GetProtocol(),
+                       sourcePort,
+                       destinationPort);
+    }
+
+    /// Tracked flow for key, evicting the smallest one if the table is full; null if untracked
+    Flow* Lookup(const FlowKey& key, bool create)
+    {
+        auto it = m_flows.find(key);
+        if (it != m_flows.end())
+        {
+            return &it->second;
+        }
+        if (!create)
+        {
+            return nullptr;
+        }
+
+        uint64_t inherited = 0;
+        if (m_maxFlows > 0 && m_flows.size() >= m_maxFlows)
+        {
+            auto smallest = m_flows.begin();
+            for (auto f = m_flows.begin(); f != m_flows.end(); ++f)
+            {
+                if (f->second.count < smallest->second.count)
+                {
+                    smallest = f;
+                }
+            }
+            inherited = smallest->second.count;
+            m_flows.erase(smallest);
+            m_evictions++;
+        }
+
+        Flow& flow = m_flows[key];
+        flow.id = m_nextFlowId++;
+        flow.count = inherited;
+        return &flow;
+    }
+
+    void SendOutgoing(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface)
+    {
+        m_probeEvents++;
+        if (!Sampled(packet))
+        {
+            return;
+        }
+        m_sampledPackets++;
+
+        FlowKey key = Classify(header, packet);
+        Flow* flow = Lookup(key, true);
+        Time now = Simulator::Now();
+        if (flow->txPackets == 0)
+        {
+            flow->firstTx = now;
+        }
+        flow->lastTx = now;
+        flow->txPackets++;
+        flow->txBytes += packet->GetSize() + header.GetSerializedSize();
+        flow->count++;
+        m_sendTimes[packet->GetUid()] = SendRecord{now, key, flow->id};
+        if (m_sendTimes.size() >= m_purgeSize)
+        {
+            PurgeSendTimes();
+        }
+    }
+
+    void LocalDeliver(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface)
+    {
+        m_probeEvents++;
+        if (!Sampled(packet))
+        {
+            return;
+        }
+
+        auto sent = m_sendTimes.find(packet->GetUid());
+        if (sent == m_sendTimes.end())
+        {
+            return; // sent from a node without probes, or its flow was evicted
+        }
+        Time delay = Simulator::Now() - sent->second.time;
+        FlowId id = sent->second.id;
+        m_sendTimes.erase(sent);
+
+        Flow* flow = Lookup(Classify(header, packet), false);
+        if (!flow || flow->id != id)
+        {
+            return; // sent before its flow was evicted
+        }
+        Time now = Simulator::Now();
+        if (flow->rxPackets == 0)
+        {
+            flow->firstRx = now;
+        }
+        flow->lastRx = now;
+        flow->rxPackets++;
+        flow->rxBytes += packet->GetSize() + header.GetSerializedSize();
+        flow->delaySum += delay;
+        flow->count++;
+    }
+
+    /// Drop send times older than m_maxDelay or whose flow was evicted; amortized over inserts
+    void PurgeSendTimes()
+    {
+        Time oldest = Simulator::Now() - m_maxDelay;
+        for (auto it = m_sendTimes.begin(); it != m_sendTimes.end();)
+        {
+            auto flow = m_flows.find(it->second.key);
+            if (it->second.time < oldest || flow == m_flows.end() || flow->second.id != it->second.id)
+            {
+                it = m_sendTimes.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        m_purgeSize = std::max(PURGE_MIN_SIZE, 2 * m_sendTimes.size());
+    }
+
+    uint32_t m_samplingRate;
+    uint32_t m_maxFlows;
+    Time m_maxDelay;
+    FlowId m_nextFlowId;
+    std::map<FlowKey, Flow> m_flows;
+    std::unordered_map<uint64_t, SendRecord> m_sendTimes;
+    size_t m_purgeSize;
+
+    uint64_t m_probeEvents;
+    uint64_t m_sampledPackets;
+    uint64_t m_evictions;
+};
+
+/**
+ * Counts the IPv4 trace events FlowMonitorHelper::InstallAll() probes on
+ * every node (SendOutgoing, UnicastForward and LocalDeliver). Installed next
+ * to InstallAll(), it gives the deterministic cost that SampledFlowMonitor's
+ * probe event count is compared with; wall time is too noisy for that.
+ */
+class FlowProbeCounter
+{
+  public:
+    FlowProbeCounter()
+        : m_events(0)
+    {
+    }
+
+    void Install(const NodeContainer& nodes)
+    {
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            Ptr<Ipv4L3Protocol> ipv4 = nodes.Get(i)->GetObject<Ipv4L3Protocol>();
+            if (!ipv4)
+            {
+                continue;
+            }
+            for (const char* trace : {"SendOutgoing", "UnicastForward", "LocalDeliver"})
+            {
+                ipv4->TraceConnectWithoutContext(trace, MakeCallback(&FlowProbeCounter::Event, this));
+            }
+        }
+    }
+
+    uint64_t GetEvents() const
+    {
+        return m_events;
+    }
+
+  private:
+    void Event(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface)
+    {
+        m_events++;
+    }
+
+    uint64_t m_events;
+};
+
+} // namespace ns3
+
+#endif /* SAMPLED_FLOW_MONITOR_H */
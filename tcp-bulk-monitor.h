@@ -0,0 +1,327 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_BULK_MONITOR_H
+#define TCP_BULK_MONITOR_H
+
+#include "results-db.h"
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Bulk TCP transfers (BulkSendApplication to PacketSink) with congestion
+ * window, RTT, retransmission and goodput instrumentation. Trace values
+ * are folded into running summaries and one sample per period, so memory
+ * does not grow with the number of segments; everything is exported once
+ * at the end of the run.
+ */
+class TcpBulkMonitor
+{
+  public:
+    struct Sample
+    {
+        double time;
+        uint32_t cwnd;
+        double rttMs;
+        double goodputMbps;
+    };
+
+    struct Flow
+    {
+        TcpBulkMonitor* monitor;
+        std::string name;
+        Ptr<BulkSendApplication> sender;
+        Ptr<PacketSink> sink;
+        Time start;
+        Time stop;
+
+        uint32_t cwnd = 0;
+        Time cwndSince; // when cwnd took its current value
+        Time cwndFirst; // first cwnd trace
+        double cwndByteSeconds = 0.0; // cwnd integrated over time, up to cwndSince
+        uint32_t cwndMax = 0;
+        uint64_t cwndChanges = 0;
+        Time rtt;
+        Time rttMin = Time::Max();
+        Time rttMax;
+        Time rttSum;
+        uint64_t rttSamples = 0;
+        SequenceNumber32 highestTx;
+        uint64_t txSegments = 0;
+        uint64_t retransmissions = 0;
+        uint64_t lastRxBytes = 0;
+        std::vector<Sample> samples;
+    };
+
+    /// Select the congestion control of every TCP socket: cubic, newreno or bbr
+    static bool Configure(const std::string& congestionControl)
+    {
+        std::string typeName;
+        if (congestionControl == "cubic")
+        {
+            typeName = "ns3::TcpCubic";
+        }
+        else if (congestionControl == "newreno")
+        {
+            typeName = "ns3::TcpNewReno";
+        }
+        else if (congestionControl == "bbr")
+        {
+            typeName = "ns3::TcpBbr";
+        }
+        else
+        {
+            return false;
+        }
+        Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                           TypeIdValue(TypeId::LookupByName(typeName)));
+        Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(1448));
+        return true;
+    }
+
+    TcpBulkMonitor(Time period)
+        : m_period(period)
+    {
+    }
+
+    ~TcpBulkMonitor()
+    {
+        for (auto flow : m_flows)
+        {
+            delete flow;
+        }
+    }
+
+    /// Unlimited bulk transfer from sender to a sink on receiver (reachable at address)
+    ApplicationContainer Install(const std::string& name,
+                                 Ptr<Node> sender,
+                                 Ptr<Node> receiver,
+                                 Ipv4Address address,
+                                 uint16_t port,
+                                 Time start,
+                                 Time stop)
+    {
+        PacketSinkHelper sinkHelper("ns3::TcpSocketFactory",
+                                    InetSocketAddress(Ipv4Address::GetAny(), port));
+        ApplicationContainer apps = sinkHelper.Install(receiver);
+        apps.Start(start);
+        apps.Stop(stop);
+
+        BulkSendHelper bulkHelper("ns3::TcpSocketFactory", InetSocketAddress(address, port));
+        bulkHelper.SetAttribute("MaxBytes", UintegerValue(0));
+        ApplicationContainer senderApp = bulkHelper.Install(sender);
+        senderApp.Start(start);
+        senderApp.Stop(stop);
+        apps.Add(senderApp);
+
+        Flow* flow = new Flow;
+        flow->monitor = this;
+        flow->name = name;
+        flow->sender = DynamicCast<BulkSendApplication>(senderApp.Get(0));
+        flow->sink = DynamicCast<PacketSink>(apps.Get(0));
+        flow->start = start;
+        flow->stop = stop;
+        m_flows.push_back(flow);
+
+        // the socket only exists once the application has started
+        Simulator::Schedule(start + NanoSeconds(1), &TcpBulkMonitor::ConnectSocket, flow);
+        Simulator::Schedule(start + m_period, &TcpBulkMonitor::TakeSample, flow);
+        return apps;
+    }
+
+    double GoodputMbps(const Flow* flow) const
+    {
+        Time end = std::min(Simulator::Now(), flow->stop);
+        double duration = (end - flow->start).GetSeconds();
+        return duration > 0 ? flow->sink->GetTotalRx() * 8.0 / duration / 1e6 : 0.0;
+    }
+
+    /// Mean congestion window, each value weighted by how long it was held
+    double MeanCwnd(const Flow* flow) const
+    {
+        Time end = std::min(Simulator::Now(), flow->stop);
+        if (flow->cwndChanges == 0 || end <= flow->cwndFirst)
+        {
+            return flow->cwnd;
+        }
+        double held = flow->cwnd * (end - flow->cwndSince).GetSeconds();
+        return (flow->cwndByteSeconds + held) / (end - flow->cwndFirst).GetSeconds();
+    }
+
+    /// Goodput summed over all flows
+    double GoodputMbps() const
+    {
+        double goodput = 0.0;
+        for (const Flow* flow : m_flows)
+        {
+            goodput += GoodputMbps(flow);
+        }
+        return goodput;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        os << "\n=== TCP BULK ===" << std::endl;
+        for (const Flow* flow : m_flows)
+        {
+            os << flow->name << ": débit utile " << GoodputMbps(flow) << " Mbps ("
+               << flow->sink->GetTotalRx() << " octets)" << std::endl;
+            os << "  cwnd moyenne (pondérée par la durée) " << MeanCwnd(flow) << " octets, max " << flow->cwndMax << " octets" << std::endl;
+            if (flow->rttSamples > 0)
+            {
+                os << "  RTT moyen " << flow->rttSum.GetSeconds() * 1000.0 / flow->rttSamples
+                   << " ms, min " << flow->rttMin.GetSeconds() * 1000.0 << " ms, max "
+                   << flow->rttMax.GetSeconds() * 1000.0 << " ms" << std::endl;
+            }
+            os << "  segments émis " << flow->txSegments << ", retransmissions "
+               << flow->retransmissions << std::endl;
+        }
+    }
+
+    void Export(const std::string& filename) const
+    {
+        std::ofstream outFile(filename);
+        outFile << "Flow,TimeS,CwndBytes,RttMs,GoodputMbps\n";
+        for (const Flow* flow : m_flows)
+        {
+            for (const Sample& sample : flow->samples)
+            {
+                outFile << flow->name << "," << sample.time << "," << sample.cwnd << ","
+                        << sample.rttMs << "," << sample.goodputMbps << "\n";
+            }
+        }
+        outFile.close();
+    }
+
+    void Record(ResultsDb& results) const
+    {
+        for (const Flow* flow : m_flows)
+        {
+            results.AddFlowMetric(flow->name, "goodputMbps", GoodputMbps(flow));
+            results.AddFlowMetric(flow->name, "rxBytes", flow->sink->GetTotalRx());
+            results.AddFlowMetric(flow->name, "txSegments", flow->txSegments);
+            results.AddFlowMetric(flow->name, "retransmissions", flow->retransmissions);
+            results.AddFlowMetric(flow->name, "cwndMeanBytes", MeanCwnd(flow));
+            results.AddFlowMetric(flow->name, "cwndMaxBytes", flow->cwndMax);
+            if (flow->rttSamples > 0)
+            {
+                results.AddFlowMetric(flow->name, "meanRttMs", flow->rttSum.GetSeconds() * 1000.0 / flow->rttSamples);
+                results.AddFlowMetric(flow->name, "minRttMs", flow->rttMin.GetSeconds() * 1000.0);
+            }
+            for (const Sample& sample : flow->samples)
+            {
+                results.AddSample("tcp." + flow->name + ".cwndBytes", sample.time, sample.cwnd);
+                results.AddSample("tcp." + flow->name + ".rttMs", sample.time, sample.rttMs);
+                results.AddSample("tcp." + flow->name + ".goodputMbps", sample.time, sample.goodputMbps);
+            }
+        }
+    }
+
+  private:
+    static void ConnectSocket(Flow* flow)
+    {
+        Ptr<Socket> socket = flow->sender->GetSocket();
+        socket->TraceConnectWithoutContext("CongestionWindow",
+                                           MakeBoundCallback(&TcpBulkMonitor::CwndTrace, flow));
+        socket->TraceConnectWithoutContext("RTT", MakeBoundCallback(&TcpBulkMonitor::RttTrace, flow));
+        socket->TraceConnectWithoutContext("Tx", MakeBoundCallback(&TcpBulkMonitor::TxTrace, flow));
+    }
+
+    static void CwndTrace(Flow* flow, uint32_t oldCwnd, uint32_t newCwnd)
+    {
+        Time now = Simulator::Now();
+        if (flow->cwndChanges == 0)
+        {
+            flow->cwndFirst = now;
+        }
+        else
+        {
+            flow->cwndByteSeconds += flow->cwnd * (now - flow->cwndSince).GetSeconds();
+        }
+        flow->cwnd = newCwnd;
+        flow->cwndSince = now;
+        flow->cwndMax = std::max(flow->cwndMax, newCwnd);
+        flow->cwndChanges++;
+    }
+
+    static void RttTrace(Flow* flow, Time oldRtt, Time newRtt)
+    {
+        if (newRtt.IsZero())
+        {
+            return;
+        }
+        flow->rtt = newRtt;
+        flow->rttSum += newRtt;
+        flow->rttMin = std::min(flow->rttMin, newRtt);
+        flow->rttMax = std::max(flow->rttMax, newRtt);
+        flow->rttSamples++;
+    }
+
+    // a data segment starting below the highest sequence already sent is a retransmission
+    static void TxTrace(Flow* flow,
+                        Ptr<const Packet> packet,
+                        const TcpHeader& header,
+                        Ptr<const TcpSocketBase> socket)
+    {
+        if (packet->GetSize() == 0)
+        {
+            return;
+        }
+        flow->txSegments++;
+        SequenceNumber32 end = header.GetSequenceNumber() + packet->GetSize();
+        if (header.GetSequenceNumber() < flow->highestTx)
+        {
+            flow->retransmissions++;
+        }
+        if (end > flow->highestTx)
+        {
+            flow->highestTx = end;
+        }
+    }
+
+    static void TakeSample(Flow* flow)
+    {
+        uint64_t rxBytes = flow->sink->GetTotalRx();
+        double period = flow->monitor->m_period.GetSeconds();
+        flow->samples.push_back({Simulator::Now().GetSeconds(),
+                                 flow->cwnd,
+                                 flow->rtt.GetSeconds() * 1000.0,
+                                 (rxBytes - flow->lastRxBytes) * 8.0 / period / 1e6});
+        flow->lastRxBytes = rxBytes;
+        if (Simulator::Now() + flow->monitor->m_period <= flow->stop)
+        {
+            Simulator::Schedule(flow->monitor->m_period, &TcpBulkMonitor::TakeSample, flow);
+        }
+    }
+
+    Time m_period;
+    std::vector<Flow*> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* TCP_BULK_MONITOR_H */
@@ -23,6 +23,20 @@
 #include "ns3/ssid.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/netanim-module.h"
+#include "ns3/ampdu-subframe-header.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "results-db.h"
+#include "tcp-bulk-monitor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <vector>
 
 // Default Network Topology
 //
@@ -39,6 +53,505 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("ThirdScriptExample");
 
+/**
+ * Single capture sink writing one pcapng file with one interface block per
+ * traced device. Frames can be filtered by node, frame type and UDP port and
+ * are truncated to a snap length; the output rotates over a ring of files
+ * once a file grows past a size limit, so the disk cost of a run is bounded.
+ * Wi-Fi frames are written as radiotap + MPDU (with FCS), stripped of their
+ * A-MPDU subframe delimiter, so rate and signal are kept as in the per-device
+ * radiotap pcaps.
+ */
+class PcapngCaptureSink
+{
+  public:
+    enum FrameFilter
+    {
+        FRAMES_ALL,
+        FRAMES_NO_BEACON,
+        FRAMES_DATA
+    };
+
+    // pcapng link types used by the devices of this scenario
+    static const uint16_t LINKTYPE_ETHERNET = 1;
+    static const uint16_t LINKTYPE_PPP = 9;
+    static const uint16_t LINKTYPE_IEEE802_11_RADIOTAP = 127;
+
+    struct Interface
+    {
+        PcapngCaptureSink* sink;
+        uint32_t id;
+        uint16_t linkType;
+    };
+
+    PcapngCaptureSink(const std::string& prefix,
+                      uint32_t snapLen,
+                      uint64_t maxFileBytes,
+                      uint32_t ringFiles)
+        : m_prefix(prefix),
+          m_snapLen(snapLen),
+          m_maxFileBytes(maxFileBytes),
+          m_ringFiles(ringFiles == 0 ? 1 : ringFiles),
+          m_fileIndex(0),
+          m_fileBytes(0),
+          m_frameFilter(FRAMES_ALL),
+          m_udpPort(0),
+          m_captured(0),
+          m_filtered(0),
+          m_rotations(0)
+    {
+    }
+
+    ~PcapngCaptureSink()
+    {
+        for (auto iface : m_interfaces)
+        {
+            delete iface;
+        }
+    }
+
+    void SetNodeFilter(const std::set<uint32_t>& nodes)
+    {
+        m_nodes = nodes;
+    }
+
+    void SetFrameFilter(FrameFilter filter)
+    {
+        m_frameFilter = filter;
+    }
+
+    void SetUdpPortFilter(uint16_t port)
+    {
+        m_udpPort = port;
+    }
+
+    /// Connect the sniffer trace sources of a device; returns false if filtered out by node
+    bool AddDevice(Ptr<NetDevice> device, const std::string& name)
+    {
+        if (!m_nodes.empty() && m_nodes.count(device->GetNode()->GetId()) == 0)
+        {
+            return false;
+        }
+
+        Interface* iface = new Interface;
+        iface->sink = this;
+        iface->id = m_interfaces.size();
+
+        Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice>(device);
+        if (wifiDevice)
+        {
+            iface->linkType = LINKTYPE_IEEE802_11_RADIOTAP;
+            wifiDevice->GetPhy()->TraceConnectWithoutContext(
+                "MonitorSnifferRx",
+                MakeBoundCallback(&PcapngCaptureSink::WifiSniffRx, iface));
+            wifiDevice->GetPhy()->TraceConnectWithoutContext(
+                "MonitorSnifferTx",
+                MakeBoundCallback(&PcapngCaptureSink::WifiSniffTx, iface));
+        }
+        else
+        {
+            iface->linkType = DynamicCast<CsmaNetDevice>(device) ? LINKTYPE_ETHERNET : LINKTYPE_PPP;
+            device->TraceConnectWithoutContext(
+                "PromiscSniffer",
+                MakeBoundCallback(&PcapngCaptureSink::WiredSniff, iface));
+        }
+
+        m_interfaces.push_back(iface);
+        m_names.push_back(name);
+        return true;
+    }
+
+    /// Open the first file of the ring; call once all devices are added
+    void Open()
+    {
+        OpenFile();
+    }
+
+    void Close()
+    {
+        if (m_file.is_open())
+        {
+            m_file.close();
+        }
+    }
+
+    void PrintStats(std::ostream& os) const
+    {
+        os << "Capture: " << m_captured << " frames written, " << m_filtered
+           << " filtered out, " << m_rotations << " rotations over " << m_ringFiles
+           << " file(s) " << m_prefix << "-*.pcapng" << std::endl;
+    }
+
+  private:
+    static void WifiSniffRx(Interface* iface,
+                            Ptr<const Packet> packet,
+                            uint16_t channelFreqMhz,
+                            WifiTxVector txVector,
+                            MpduInfo aMpdu,
+                            SignalNoiseDbm signalNoise,
+                            uint16_t staId)
+    {
+        iface->sink->Capture(iface,
+                             StripAmpdu(packet, aMpdu),
+                             Radiotap(channelFreqMhz, txVector, aMpdu, staId, &signalNoise));
+    }
+
+    static void WifiSniffTx(Interface* iface,
+                            Ptr<const Packet> packet,
+                            uint16_t channelFreqMhz,
+                            WifiTxVector txVector,
+                            MpduInfo aMpdu,
+                            uint16_t staId)
+    {
+        iface->sink->Capture(iface,
+                             StripAmpdu(packet, aMpdu),
+                             Radiotap(channelFreqMhz, txVector, aMpdu, staId, nullptr));
+    }
+
+    static void WiredSniff(Interface* iface, Ptr<const Packet> packet)
+    {
+        iface->sink->Capture(iface, packet, {});
+    }
+
+    /// MPDU of an A-MPDU or S-MPDU subframe, without its delimiter and padding
+    static Ptr<const Packet> StripAmpdu(Ptr<const Packet> packet, const MpduInfo& aMpdu)
+    {
+        if (aMpdu.type == NORMAL_MPDU)
+        {
+            return packet;
+        }
+        Ptr<Packet> copy = packet->Copy();
+        AmpduSubframeHeader hdr;
+        copy->RemoveHeader(hdr);
+        return copy->CreateFragment(0, hdr.GetLength());
+    }
+
+    /// Little-endian radiotap fields, each aligned to its natural size
+    struct RadiotapWriter
+    {
+        std::vector<uint8_t> bytes = std::vector<uint8_t>(8, 0); // version, pad, length, present
+        uint32_t present = 0;
+
+        void Field(uint32_t bit, uint32_t align)
+        {
+            present |= 1u << bit;
+            while (bytes.size() % align != 0)
+            {
+                bytes.push_back(0);
+            }
+        }
+
+        void Put(uint64_t value, uint32_t size)
+        {
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+            }
+        }
+
+        std::vector<uint8_t> Finish()
+        {
+            bytes[2] = bytes.size() & 0xff;
+            bytes[3] = bytes.size() >> 8;
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                bytes[4 + i] = static_cast<uint8_t>(present >> (8 * i));
+            }
+            return bytes;
+        }
+    };
+
+    /**
+     * Radiotap header for a sniffed frame: TSFT, flags, legacy rate, channel,
+     * signal and noise (received frames only), A-MPDU status and the HT, VHT
+     * or HE MCS fields, the same information WifiPhyHelper writes to
+     * DLT_IEEE802_11_RADIO pcaps.
+     */
+    static std::vector<uint8_t> Radiotap(uint16_t channelFreqMhz,
+                                         const WifiTxVector& txVector,
+                                         const MpduInfo& aMpdu,
+                                         uint16_t staId,
+                                         const SignalNoiseDbm* signalNoise)
+    {
+        WifiModulationClass modClass = txVector.GetModulationClass();
+        WifiMode mode = txVector.IsMu() ? txVector.GetMode(staId) : txVector.GetMode();
+        uint8_t nss = txVector.IsMu() ? txVector.GetNss(staId) : txVector.GetNss();
+        uint16_t width = txVector.GetChannelWidth();
+        uint16_t guardInterval = txVector.GetGuardInterval();
+        bool legacy = modClass == WIFI_MOD_CLASS_DSSS || modClass == WIFI_MOD_CLASS_HR_DSSS ||
+                      modClass == WIFI_MOD_CLASS_ERP_OFDM || modClass == WIFI_MOD_CLASS_OFDM;
+
+        RadiotapWriter rt;
+
+        rt.Field(0, 8); // TSFT
+        rt.Put(Simulator::Now().GetMicroSeconds(), 8);
+
+        rt.Field(1, 1); // flags: FCS at end, short preamble, short guard interval
+        uint8_t flags = 0x10;
+        if (txVector.GetPreambleType() == WIFI_PREAMBLE_SHORT)
+        {
+            flags |= 0x02;
+        }
+        if ((modClass == WIFI_MOD_CLASS_HT || modClass == WIFI_MOD_CLASS_VHT) && guardInterval == 400)
+        {
+            flags |= 0x80;
+        }
+        rt.Put(flags, 1);
+
+        if (legacy)
+        {
+            rt.Field(2, 1); // rate in 500 kb/s
+            rt.Put(mode.GetDataRate(txVector) / 500000, 1);
+        }
+
+        rt.Field(3, 2); // channel: frequency, then band and modulation flags
+        uint16_t channelFlags = channelFreqMhz < 2500 ? 0x0080 : 0x0100;
+        if (modClass == WIFI_MOD_CLASS_DSSS || modClass == WIFI_MOD_CLASS_HR_DSSS)
+        {
+            channelFlags |= 0x0020;
+        }
+        else if (legacy)
+        {
+            channelFlags |= 0x0040;
+        }
+        rt.Put(channelFreqMhz, 2);
+        rt.Put(channelFlags, 2);
+
+        if (signalNoise)
+        {
+            rt.Field(5, 1); // antenna signal, dBm
+            rt.Put(static_cast<int8_t>(std::round(signalNoise->signal)), 1);
+            rt.Field(6, 1); // antenna noise, dBm
+            rt.Put(static_cast<int8_t>(std::round(signalNoise->noise)), 1);
+        }
+
+        if (modClass == WIFI_MOD_CLASS_HT)
+        {
+            rt.Field(19, 1); // MCS: bandwidth, index and guard interval known
+            rt.Put(0x07, 1);
+            rt.Put((width == 40 ? 0x01 : 0x00) | (guardInterval == 400 ? 0x04 : 0x00), 1);
+            rt.Put(mode.GetMcsValue(), 1);
+        }
+
+        if (aMpdu.type != NORMAL_MPDU)
+        {
+            rt.Field(20, 4); // A-MPDU status: reference, last subframe known/last
+            rt.Put(aMpdu.mpduRefNumber, 4);
+            bool last = aMpdu.type == LAST_MPDU_IN_AGGREGATE || aMpdu.type == SINGLE_MPDU;
+            rt.Put(0x0004 | (last ? 0x0008 : 0x0000), 2);
+            rt.Put(0, 2);
+        }
+
+        if (modClass == WIFI_MOD_CLASS_VHT)
+        {
+            rt.Field(21, 2); // VHT: guard interval and bandwidth known, user 0 MCS/NSS
+            rt.Put(0x0044, 2);
+            rt.Put(guardInterval == 400 ? 0x04 : 0x00, 1);
+            rt.Put(width == 160 ? 11 : (width == 80 ? 4 : (width == 40 ? 1 : 0)), 1);
+            rt.Put((mode.GetMcsValue() << 4) | nss, 1);
+            rt.Put(0, 3);
+            rt.Put(0, 1); // coding
+            rt.Put(0, 1); // group id
+            rt.Put(0, 2); // partial AID
+        }
+
+        if (modClass == WIFI_MOD_CLASS_HE)
+        {
+            rt.Field(23, 2); // HE: data MCS, bandwidth and guard interval known
+            rt.Put(0x0020 | 0x4000, 2);
+            rt.Put(0x0002, 2);
+            rt.Put(mode.GetMcsValue() << 8, 2);
+            rt.Put(0, 2);
+            uint16_t bandwidth = width == 160 ? 3 : (width == 80 ? 2 : (width == 40 ? 1 : 0));
+            uint16_t gi = guardInterval == 3200 ? 2 : (guardInterval == 1600 ? 1 : 0);
+            rt.Put(bandwidth | (gi << 4), 2);
+            rt.Put(nss, 2);
+        }
+
+        return rt.Finish();
+    }
+
+    bool Accept(const Interface* iface, Ptr<const Packet> packet) const
+    {
+        Ptr<Packet> copy = packet->Copy();
+        uint16_t protocol = 0;
+
+        if (iface->linkType == LINKTYPE_IEEE802_11_RADIOTAP)
+        {
+            WifiMacHeader hdr;
+            copy->RemoveHeader(hdr);
+            if (m_frameFilter == FRAMES_NO_BEACON && hdr.IsBeacon())
+            {
+                return false;
+            }
+            if (m_frameFilter == FRAMES_DATA && !hdr.IsData())
+            {
+                return false;
+            }
+            if (m_udpPort == 0)
+            {
+                return true;
+            }
+            LlcSnapHeader llc;
+            if (!hdr.IsData() || copy->GetSize() < llc.GetSerializedSize())
+            {
+                return false;
+            }
+            copy->RemoveHeader(llc);
+            protocol = llc.GetType();
+        }
+        else if (m_udpPort == 0)
+        {
+            return true;
+        }
+        else if (iface->linkType == LINKTYPE_ETHERNET)
+        {
+            EthernetHeader eth(false);
+            copy->RemoveHeader(eth);
+            protocol = eth.GetLengthType();
+        }
+        else
+        {
+            PppHeader ppp;
+            copy->RemoveHeader(ppp);
+            protocol = ppp.GetProtocol() == 0x0021 ? 0x0800 : 0;
+        }
+
+        if (protocol != 0x0800)
+        {
+            return false;
+        }
+        Ipv4Header ip;
+        copy->RemoveHeader(ip);
+        if (ip.GetProtocol() != UdpL4Protocol::PROT_NUMBER || ip.GetFragmentOffset() != 0)
+        {
+            return false;
+        }
+        UdpHeader udp;
+        copy->PeekHeader(udp);
+        return udp.GetSourcePort() == m_udpPort || udp.GetDestinationPort() == m_udpPort;
+    }
+
+    /// Write packet, preceded by linkHeader (radiotap for Wi-Fi), if it passes the filters
+    void Capture(const Interface* iface, Ptr<const Packet> packet, const std::vector<uint8_t>& linkHeader)
+    {
+        if (!Accept(iface, packet))
+        {
+            ++m_filtered;
+            return;
+        }
+
+        if (m_maxFileBytes > 0 && m_fileBytes >= m_maxFileBytes)
+        {
+            m_fileIndex = (m_fileIndex + 1) % m_ringFiles;
+            ++m_rotations;
+            OpenFile();
+        }
+
+        uint32_t origLen = linkHeader.size() + packet->GetSize();
+        uint32_t capLen = (m_snapLen > 0 && origLen > m_snapLen) ? m_snapLen : origLen;
+        uint32_t padLen = (4 - capLen % 4) % 4;
+        std::vector<uint8_t> buffer(capLen + padLen, 0);
+        uint32_t headerLen = std::min<uint32_t>(linkHeader.size(), capLen);
+        std::copy(linkHeader.begin(), linkHeader.begin() + headerLen, buffer.begin());
+        packet->CopyData(buffer.data() + headerLen, capLen - headerLen);
+
+        uint64_t ts = Simulator::Now().GetNanoSeconds();
+        uint32_t blockLen = 32 + capLen + padLen;
+        Write32(0x00000006);
+        Write32(blockLen);
+        Write32(iface->id);
+        Write32(static_cast<uint32_t>(ts >> 32));
+        Write32(static_cast<uint32_t>(ts & 0xffffffff));
+        Write32(capLen);
+        Write32(origLen);
+        m_file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        Write32(blockLen);
+        m_fileBytes += blockLen;
+        ++m_captured;
+    }
+
+    void OpenFile()
+    {
+        Close();
+        std::ostringstream name;
+        name << m_prefix << "-" << std::setw(2) << std::setfill('0') << m_fileIndex << ".pcapng";
+        m_file.open(name.str(), std::ios::binary | std::ios::trunc);
+        m_fileBytes = 0;
+
+        // Section Header Block, section length unspecified
+        Write32(0x0A0D0D0A);
+        Write32(28);
+        Write32(0x1A2B3C4D);
+        Write16(1);
+        Write16(0);
+        Write32(0xffffffff);
+        Write32(0xffffffff);
+        Write32(28);
+        m_fileBytes += 28;
+
+        // one Interface Description Block per device, with if_name and
+        // nanosecond if_tsresol options, plus if_fcslen for Wi-Fi, whose
+        // sniffed MPDUs carry their 4-byte FCS
+        for (uint32_t i = 0; i < m_interfaces.size(); ++i)
+        {
+            const std::string& ifName = m_names[i];
+            bool wifi = m_interfaces[i]->linkType == LINKTYPE_IEEE802_11_RADIOTAP;
+            uint32_t namePad = (4 - ifName.size() % 4) % 4;
+            uint32_t blockLen = 20 + 4 + ifName.size() + namePad + 8 + (wifi ? 8 : 0) + 4;
+            Write32(0x00000001);
+            Write32(blockLen);
+            Write16(m_interfaces[i]->linkType);
+            Write16(0);
+            Write32(m_snapLen);
+            Write16(2);
+            Write16(ifName.size());
+            m_file.write(ifName.data(), ifName.size());
+            m_file.write("\0\0\0", namePad);
+            Write16(9);
+            Write16(1);
+            m_file.write("\x09\0\0\0", 4);
+            if (wifi)
+            {
+                Write16(13);
+                Write16(1);
+                m_file.write("\x04\0\0\0", 4);
+            }
+            Write32(0);
+            Write32(blockLen);
+            m_fileBytes += blockLen;
+        }
+    }
+
+    void Write16(uint16_t value)
+    {
+        m_file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void Write32(uint32_t value)
+    {
+        m_file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::string m_prefix;
+    uint32_t m_snapLen;
+    uint64_t m_maxFileBytes;
+    uint32_t m_ringFiles;
+    uint32_t m_fileIndex;
+    uint64_t m_fileBytes;
+    std::ofstream m_file;
+
+    std::vector<Interface*> m_interfaces;
+    std::vector<std::string> m_names;
+    std::set<uint32_t> m_nodes;
+    FrameFilter m_frameFilter;
+    uint16_t m_udpPort;
+
+    uint64_t m_captured;
+    uint64_t m_filtered;
+    uint32_t m_rotations;
+};
+
 int
 main(int argc, char* argv[])
 {
@@ -46,15 +559,58 @@ main(int argc, char* argv[])
     uint32_t nCsma = 3;
     uint32_t nWifi = 3;
     bool tracing = false;
+    std::string captureNodes = "";
+    std::string captureFrames = "nobeacon";
+    uint16_t capturePort = 0;
+    uint32_t snapLen = 128;
+    uint32_t captureMaxKb = 10240;
+    uint32_t captureRing = 4;
+    std::string transport = "udp";
+    std::string tcpCc = "cubic";
+    std::string resultsDb = "tp2/results.db";
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("nCsma", "Number of \"extra\" CSMA nodes/devices", nCsma);
     cmd.AddValue("nWifi", "Number of wifi STA devices", nWifi);
     cmd.AddValue("verbose", "Tell echo applications to log if true", verbose);
     cmd.AddValue("tracing", "Enable pcap tracing", tracing);
+    cmd.AddValue("captureNodes", "Comma-separated node ids to capture (empty = all)", captureNodes);
+    cmd.AddValue("captureFrames", "Captured frame types: all, nobeacon or data", captureFrames);
+    cmd.AddValue("capturePort", "Only capture UDP frames to/from this port (0 = any)", capturePort);
+    cmd.AddValue("snapLen", "Bytes kept per captured frame (0 = full frame)", snapLen);
+    cmd.AddValue("captureMaxKb", "Size of one capture file before rotating (0 = no limit)", captureMaxKb);
+    cmd.AddValue("captureRing", "Number of capture files in the rotation ring", captureRing);
+
+    cmd.AddValue("transport", "Workload from the last STA to the last CSMA node: udp (echo), udpbulk (saturating UDP) or tcp (bulk transfer)", transport);
+    cmd.AddValue("tcpCc", "TCP congestion control: cubic, newreno or bbr", tcpCc);
+    cmd.AddValue("resultsDb", "SQLite database the run is appended to (empty = disabled)", resultsDb);
 
     cmd.Parse(argc, argv);
 
+    if (transport != "udp" && transport != "udpbulk" && transport != "tcp")
+    {
+        std::cout << "transport should be udp, udpbulk or tcp" << std::endl;
+        return 1;
+    }
+
+    if (!TcpBulkMonitor::Configure(tcpCc))
+    {
+        std::cout << "tcpCc should be cubic, newreno or bbr" << std::endl;
+        return 1;
+    }
+
+    ResultsDb results("third", __FILE__);
+    results.AddParam("nCsma", nCsma);
+    results.AddParam("nWifi", nWifi);
+    results.AddParam("transport", transport);
+    results.AddParam("tcpCc", tcpCc);
+
+    if (captureFrames != "all" && captureFrames != "nobeacon" && captureFrames != "data")
+    {
+        std::cout << "captureFrames should be all, nobeacon or data" << std::endl;
+        return 1;
+    }
+
     // The underlying restriction of 18 is due to the grid position
     // allocator's configuration; the grid layout will exceed the
     // bounding box if more than 18 nodes are provided.
@@ -158,20 +714,57 @@ main(int argc, char* argv[])
     address.Assign(staDevices);
     address.Assign(apDevices);
 
-    UdpEchoServerHelper echoServer(9);
+    // bulk TCP, or saturating UDP as its baseline, replaces the echo exchange
+    // over the same path and time window
+    const Time bulkStart = Seconds(2.0);
+    const Time bulkStop = Seconds(10.0);
+    const uint32_t bulkPacketSize = 1448;
+    const double bulkOfferedMbps = 10.0; // twice the 5 Mbps point-to-point bottleneck
+    TcpBulkMonitor tcp(Seconds(0.5));
+    Ptr<UdpServer> udpBulkServer;
+    if (transport == "tcp")
+    {
+        tcp.Install("sta-csma",
+                    wifiStaNodes.Get(nWifi - 1),
+                    csmaNodes.Get(nCsma),
+                    csmaInterfaces.GetAddress(nCsma),
+                    9,
+                    bulkStart,
+                    bulkStop);
+    }
+    else if (transport == "udpbulk")
+    {
+        UdpServerHelper server(9);
+        ApplicationContainer serverApps = server.Install(csmaNodes.Get(nCsma));
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(bulkStop);
+        udpBulkServer = DynamicCast<UdpServer>(serverApps.Get(0));
+
+        UdpClientHelper client(csmaInterfaces.GetAddress(nCsma), 9);
+        client.SetAttribute("MaxPackets", UintegerValue(0));
+        client.SetAttribute("Interval", TimeValue(Seconds(bulkPacketSize * 8.0 / (bulkOfferedMbps * 1e6))));
+        client.SetAttribute("PacketSize", UintegerValue(bulkPacketSize));
+        ApplicationContainer clientApps = client.Install(wifiStaNodes.Get(nWifi - 1));
+        clientApps.Start(bulkStart);
+        clientApps.Stop(bulkStop);
+    }
+    else
+    {
+        UdpEchoServerHelper echoServer(9);
 
-    ApplicationContainer serverApps = echoServer.Install(csmaNodes.Get(nCsma));
-    serverApps.Start(Seconds(1.0));
-    serverApps.Stop(Seconds(10.0));
+        ApplicationContainer serverApps = echoServer.Install(csmaNodes.Get(nCsma));
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(Seconds(10.0));
 
-    UdpEchoClientHelper echoClient(csmaInterfaces.GetAddress(nCsma), 9);
-    echoClient.SetAttribute("MaxPackets", UintegerValue(1));
-    echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
-    echoClient.SetAttribute("PacketSize", UintegerValue(1024));
+        UdpEchoClientHelper echoClient(csmaInterfaces.GetAddress(nCsma), 9);
+        echoClient.SetAttribute("MaxPackets", UintegerValue(1));
+        echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
+        echoClient.SetAttribute("PacketSize", UintegerValue(1024));
 
-    ApplicationContainer clientApps = echoClient.Install(wifiStaNodes.Get(nWifi - 1));
-    clientApps.Start(Seconds(2.0));
-    clientApps.Stop(Seconds(10.0));
+        ApplicationContainer clientApps = echoClient.Install(wifiStaNodes.Get(nWifi - 1));
+        clientApps.Start(Seconds(2.0));
+        clientApps.Stop(Seconds(10.0));
+    }
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
@@ -182,6 +775,8 @@ main(int argc, char* argv[])
 
     Simulator::Stop(Seconds(10.0));
 
+    PcapngCaptureSink capture("tp2/third", snapLen, uint64_t(captureMaxKb) * 1024, captureRing);
+
     if (tracing)
     {
         // ensure output directory exists (works on macOS)
@@ -191,33 +786,85 @@ main(int argc, char* argv[])
         AsciiTraceHelper ascii;
         Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream("tp2/tracemetrics");
 
-        // Use radio DLT for wifi pcap files
-        phy.SetPcapDataLinkType(WifiPhyHelper::DLT_IEEE802_11_RADIO);
-
-        // P2P: enable pcap and ASCII tracing on all point-to-point devices (files saved in tp2/)
-        pointToPoint.EnablePcapAll("tp2/third-p2p");
+        // P2P and CSMA: ASCII tracing on all devices
         pointToPoint.EnableAsciiAll(stream);
+        csma.EnableAsciiAll(stream);
 
-        // CSMA: enable pcap on all CSMA devices (promiscuous = true) and ASCII tracing
+        // all devices feed a single pcapng sink (tp2/third-NN.pcapng), one
+        // interface block per device
+        std::set<uint32_t> nodes;
+        std::istringstream nodeList(captureNodes);
+        std::string nodeId;
+        while (std::getline(nodeList, nodeId, ','))
+        {
+            if (!nodeId.empty())
+            {
+                nodes.insert(std::stoul(nodeId));
+            }
+        }
+        capture.SetNodeFilter(nodes);
+        capture.SetFrameFilter(captureFrames == "data"
+                                   ? PcapngCaptureSink::FRAMES_DATA
+                                   : (captureFrames == "nobeacon" ? PcapngCaptureSink::FRAMES_NO_BEACON
+                                                                  : PcapngCaptureSink::FRAMES_ALL));
+        capture.SetUdpPortFilter(capturePort);
+
+        for (uint32_t i = 0; i < p2pDevices.GetN(); ++i)
+        {
+            capture.AddDevice(p2pDevices.Get(i), "p2p-" + std::to_string(p2pDevices.Get(i)->GetNode()->GetId()));
+        }
         for (uint32_t i = 0; i < csmaDevices.GetN(); ++i)
         {
-            csma.EnablePcap("tp2/third-csma", csmaDevices.Get(i), true);
+            capture.AddDevice(csmaDevices.Get(i), "csma-" + std::to_string(csmaDevices.Get(i)->GetNode()->GetId()));
         }
-        csma.EnableAsciiAll(stream);
-
-        // Wi-Fi PHY: enable pcap on the AP and on each STA and ASCII tracing for all PHY devices
-        if (apDevices.GetN() > 0)
+        for (uint32_t i = 0; i < apDevices.GetN(); ++i)
         {
-            phy.EnablePcap("tp2/third-wifi-ap", apDevices.Get(0));
+            capture.AddDevice(apDevices.Get(i), "wifi-ap-" + std::to_string(apDevices.Get(i)->GetNode()->GetId()));
         }
         for (uint32_t i = 0; i < staDevices.GetN(); ++i)
         {
-            phy.EnablePcap("tp2/third-wifi-sta", staDevices.Get(i));
+            capture.AddDevice(staDevices.Get(i), "wifi-sta-" + std::to_string(staDevices.Get(i)->GetNode()->GetId()));
         }
+        capture.Open();
+
+        // Wi-Fi PHY: ASCII tracing for all PHY devices
         phy.EnableAsciiAll(stream);
     }
 
     Simulator::Run();
+
+    if (tracing)
+    {
+        capture.Close();
+        capture.PrintStats(std::cout);
+    }
+
+    // the echo workload is a single request: only the bulk modes have a goodput,
+    // and TCP is compared with the saturating UDP run of the same configuration
+    if (transport != "udp")
+    {
+        double goodput = transport == "tcp"
+                             ? tcp.GoodputMbps()
+                             : udpBulkServer->GetReceived() * bulkPacketSize * 8.0 /
+                                   (bulkStop - bulkStart).GetSeconds() / 1e6;
+        results.AddMetric("goodputMbps", goodput);
+        std::cout << "Application goodput (" << transport << "): " << goodput << " Mbps" << std::endl;
+    }
+
+    if (transport == "tcp")
+    {
+        tcp.Report(std::cout);
+        tcp.Export("tp2/third-tcp.csv");
+        tcp.Record(results);
+        results.CompareWithRun(resultsDb, "transport", "udpbulk", "goodputMbps", tcp.GoodputMbps(),
+                               "tcpUdpGoodputRatio", "TCP/UDP goodput ratio", std::cout);
+    }
+
+    if (!resultsDb.empty())
+    {
+        results.Commit(resultsDb);
+    }
+
     Simulator::Destroy();
     return 0;
 }
@@ -26,8 +26,26 @@
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/flow-monitor.h"
 #include "ns3/ipv4-flow-classifier.h"
+#include "ns3/multi-model-spectrum-channel.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/spectrum-wifi-helper.h"
+#include "airtime-monitor.h"
+#include "results-db.h"
+#include "sampled-flow-monitor.h"
+#include "tcp-bulk-monitor.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <set>
 #include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
 
 using namespace ns3;
 
@@ -81,6 +99,155 @@ public:
 
 PacketDelayTracker clientTracker;
 
+/**
+ * One-way delay accounting for every flow carrying a SeqTsHeader (UdpClient
+ * traffic). Each receiver computes delay, RFC 3550 interarrival jitter,
+ * reordering and loss per flow; delays are binned into a fixed-size
+ * histogram so the per-packet cost stays constant with many flows.
+ */
+class OneWayDelayTracker
+{
+public:
+    static const uint32_t HISTOGRAM_BINS = 128;
+
+    struct FlowStats
+    {
+        uint32_t received = 0;
+        uint32_t reordered = 0;
+        uint32_t highestSeq = 0;
+        Time delaySum;
+        Time minDelay = Time::Max();
+        Time maxDelay;
+        Time lastTransit;
+        double jitterMs = 0.0;
+        std::array<uint32_t, HISTOGRAM_BINS> histogram{}; // the last bin also holds overflow
+    };
+
+    // (source address, source port, destination port)
+    typedef std::tuple<uint32_t, uint16_t, uint16_t> FlowKey;
+
+    std::map<FlowKey, FlowStats> flows;
+    Time binWidth = MilliSeconds(1);
+    uint32_t sentPerFlow = 0; // packets each UdpClient sends, so tail losses are counted
+
+    /// UdpClient numbers packets from 0: everything up to the highest seen or sent was expected
+    uint32_t Lost(const FlowStats& flow) const
+    {
+        uint32_t expected = std::max(flow.highestSeq + 1, sentPerFlow);
+        return expected > flow.received ? expected - flow.received : 0;
+    }
+
+    void Receive(Ptr<const Packet> packet, const Address& from, const Address& local)
+    {
+        SeqTsHeader seqTs;
+        if (packet->GetSize() < seqTs.GetSerializedSize())
+        {
+            return;
+        }
+        packet->PeekHeader(seqTs);
+
+        InetSocketAddress src = InetSocketAddress::ConvertFrom(from);
+        InetSocketAddress dst = InetSocketAddress::ConvertFrom(local);
+        FlowKey key(src.GetIpv4().Get(), src.GetPort(), dst.GetPort());
+        FlowStats& flow = flows[key];
+
+        uint32_t seq = seqTs.GetSeq();
+        Time transit = Simulator::Now() - seqTs.GetTs();
+
+        if (flow.received == 0)
+        {
+            flow.highestSeq = seq;
+        }
+        else
+        {
+            // RFC 3550 interarrival jitter: J += (|D(i-1,i)| - J) / 16
+            double d = std::abs((transit - flow.lastTransit).GetSeconds() * 1000.0);
+            flow.jitterMs += (d - flow.jitterMs) / 16.0;
+
+            if (seq < flow.highestSeq)
+            {
+                flow.reordered++;
+            }
+            flow.highestSeq = std::max(flow.highestSeq, seq);
+        }
+        flow.lastTransit = transit;
+        flow.received++;
+        flow.delaySum += transit;
+        flow.minDelay = std::min(flow.minDelay, transit);
+        flow.maxDelay = std::max(flow.maxDelay, transit);
+
+        uint64_t bin = transit.GetNanoSeconds() / binWidth.GetNanoSeconds();
+        flow.histogram[std::min<uint64_t>(bin, HISTOGRAM_BINS - 1)]++;
+    }
+
+    /// Delay below which a fraction q of the packets of a flow arrived, from its histogram
+    Time Quantile(const FlowStats& flow, double q) const
+    {
+        uint32_t target = static_cast<uint32_t>(std::ceil(q * flow.received));
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < HISTOGRAM_BINS - 1; ++i)
+        {
+            count += flow.histogram[i];
+            if (count >= target)
+            {
+                return binWidth * (i + 1);
+            }
+        }
+        // the quantile falls in the overflow bin: the maximum is the only bound known
+        return flow.maxDelay;
+    }
+
+    void ExportFlows(const std::string& filename)
+    {
+        std::ofstream outFile(filename);
+        outFile << "Source,SourcePort,DestPort,Received,Lost,Reordered,MeanDelayMs,MinDelayMs,"
+                   "MaxDelayMs,P95DelayMs,JitterMs\n";
+
+        for (const auto& entry : flows)
+        {
+            const FlowStats& flow = entry.second;
+            outFile << Ipv4Address(std::get<0>(entry.first)) << "," << std::get<1>(entry.first)
+                    << "," << std::get<2>(entry.first) << "," << flow.received << ","
+                    << Lost(flow) << "," << flow.reordered << ","
+                    << flow.delaySum.GetSeconds() * 1000.0 / flow.received << ","
+                    << flow.minDelay.GetSeconds() * 1000.0 << ","
+                    << flow.maxDelay.GetSeconds() * 1000.0 << ","
+                    << Quantile(flow, 0.95).GetSeconds() * 1000.0 << "," << flow.jitterMs
+                    << "\n";
+        }
+        outFile.close();
+    }
+
+    void ExportHistograms(const std::string& filename)
+    {
+        std::ofstream outFile(filename);
+        outFile << "Source,SourcePort,DestPort,BinStartMs,Count\n";
+
+        for (const auto& entry : flows)
+        {
+            for (uint32_t i = 0; i < HISTOGRAM_BINS; ++i)
+            {
+                if (entry.second.histogram[i] == 0)
+                {
+                    continue;
+                }
+                outFile << Ipv4Address(std::get<0>(entry.first)) << ","
+                        << std::get<1>(entry.first) << "," << std::get<2>(entry.first) << ","
+                        << (binWidth * i).GetSeconds() * 1000.0 << ","
+                        << entry.second.histogram[i] << "\n";
+            }
+        }
+        outFile.close();
+    }
+};
+
+OneWayDelayTracker oneWayTracker;
+
+void ServerRxTrace(Ptr<const Packet> packet, const Address& from, const Address& local)
+{
+    oneWayTracker.Receive(packet, from, local);
+}
+
 void ClientTxTrace(Ptr<const Packet> packet)
 {
     uint32_t packetId = packet->GetUid();
@@ -95,6 +262,348 @@ void ClientRxTrace(Ptr<const Packet> packet)
     clientTracker.RecordReceiveTime(packetId, receiveTime);
 }
 
+/**
+ * Channel assignment for dense multi-BSS deployments. N BSSes share one
+ * spectrum channel, so BSSes on overlapping 5 GHz channels contend with
+ * each other. Plans are scored with short saturated downlink runs, several
+ * at a time in forked processes (the simulator is a singleton), and improved
+ * by local search: each pass tries every channel/width option on each BSS
+ * and keeps the best plan.
+ */
+struct ChannelOption
+{
+    uint16_t number;
+    uint16_t width;
+
+    bool operator<(const ChannelOption& other) const
+    {
+        return std::tie(number, width) < std::tie(other.number, other.width);
+    }
+
+    bool operator==(const ChannelOption& other) const
+    {
+        return number == other.number && width == other.width;
+    }
+};
+
+struct ChannelPlanConfig
+{
+    uint32_t nBss;
+    uint32_t nSta;
+    double spacing;
+    double loadMbps;
+    double time;
+    uint32_t jobs;
+    uint32_t passes;
+};
+
+struct PlanResult
+{
+    std::vector<double> goodputMbps;
+
+    double Aggregate() const
+    {
+        double sum = 0.0;
+        for (double g : goodputMbps)
+        {
+            sum += g;
+        }
+        return sum;
+    }
+
+    double Worst() const
+    {
+        return goodputMbps.empty() ? 0.0 : *std::min_element(goodputMbps.begin(), goodputMbps.end());
+    }
+
+    // proportional fairness: starving one BSS to boost the others does not pay
+    double Score() const
+    {
+        double score = 0.0;
+        for (double g : goodputMbps)
+        {
+            score += std::log(std::max(g, 1e-3));
+        }
+        return score;
+    }
+};
+
+typedef std::vector<ChannelOption> ChannelPlan;
+
+std::string PlanToString(const ChannelPlan& plan)
+{
+    std::ostringstream oss;
+    for (uint32_t i = 0; i < plan.size(); ++i)
+    {
+        oss << (i > 0 ? " " : "") << plan[i].number << "/" << plan[i].width;
+    }
+    return oss.str();
+}
+
+/// 20 MHz channels of the list, plus the 40 MHz channels whose two halves are both in it
+std::vector<ChannelOption> ChannelOptions(const std::set<uint16_t>& channels, const std::set<uint16_t>& widths)
+{
+    // lower 20 MHz half of every 5 GHz 40 MHz channel; the 40 MHz channel is centered 2 above
+    static const uint16_t pairs40[] = {36, 44, 52, 60, 100, 108, 116, 124, 132, 140, 149, 157};
+
+    std::vector<ChannelOption> options;
+    if (widths.count(20))
+    {
+        for (uint16_t channel : channels)
+        {
+            options.push_back({channel, 20});
+        }
+    }
+    if (widths.count(40))
+    {
+        for (uint16_t lower : pairs40)
+        {
+            if (channels.count(lower) && channels.count(lower + 4))
+            {
+                options.push_back({static_cast<uint16_t>(lower + 2), 40});
+            }
+        }
+    }
+    return options;
+}
+
+/// Build and run one dense deployment with the given plan; per-BSS downlink goodput in Mbps
+PlanResult EvaluatePlan(const ChannelPlanConfig& config, const ChannelPlan& plan)
+{
+    const uint32_t packetSize = 1200;
+
+    Ptr<MultiModelSpectrumChannel> spectrumChannel = CreateObject<MultiModelSpectrumChannel>();
+    spectrumChannel->AddPropagationLossModel(CreateObject<LogDistancePropagationLossModel>());
+    spectrumChannel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+
+    SpectrumWifiPhyHelper phy;
+    phy.SetChannel(spectrumChannel);
+
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211n);
+    WifiMacHelper mac;
+
+    InternetStackHelper stack;
+    Ipv4AddressHelper address;
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+
+    uint32_t columns = std::ceil(std::sqrt(config.nBss));
+    std::vector<ApplicationContainer> servers(config.nBss);
+
+    for (uint32_t b = 0; b < config.nBss; ++b)
+    {
+        NodeContainer apNode;
+        apNode.Create(1);
+        NodeContainer staNodes;
+        staNodes.Create(config.nSta);
+
+        phy.Set("ChannelSettings",
+                StringValue("{" + std::to_string(plan[b].number) + ", " +
+                            std::to_string(plan[b].width) + ", BAND_5GHZ, 0}"));
+
+        Ssid ssid = Ssid("ns-3-ssid-plan-" + std::to_string(b));
+        mac.SetType("ns3::StaWifiMac", "Ssid", SsidValue(ssid), "ActiveProbing", BooleanValue(false));
+        NetDeviceContainer staDevices = wifi.Install(phy, mac, staNodes);
+        mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid));
+        NetDeviceContainer apDevices = wifi.Install(phy, mac, apNode);
+
+        // APs on a grid, STAs on a 3 m circle around their AP
+        Vector apPosition((b % columns) * config.spacing, (b / columns) * config.spacing, 0.0);
+        Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+        positions->Add(apPosition);
+        for (uint32_t i = 0; i < config.nSta; ++i)
+        {
+            double angle = 2 * M_PI * i / config.nSta;
+            positions->Add(Vector(apPosition.x + 3.0 * std::cos(angle),
+                                  apPosition.y + 3.0 * std::sin(angle),
+                                  0.0));
+        }
+        mobility.SetPositionAllocator(positions);
+        mobility.Install(apNode);
+        mobility.Install(staNodes);
+
+        stack.Install(apNode);
+        stack.Install(staNodes);
+        address.SetBase(("10.10." + std::to_string(b) + ".0").c_str(), "255.255.255.0");
+        Ipv4InterfaceContainer staInterfaces = address.Assign(staDevices);
+        address.Assign(apDevices);
+
+        // saturating downlink, the offered load of the BSS is split over its STAs
+        double interval = packetSize * 8.0 * config.nSta / (config.loadMbps * 1e6);
+        for (uint32_t i = 0; i < config.nSta; ++i)
+        {
+            UdpServerHelper server(9);
+            servers[b].Add(server.Install(staNodes.Get(i)));
+
+            UdpClientHelper client(staInterfaces.GetAddress(i), 9);
+            client.SetAttribute("MaxPackets", UintegerValue(0));
+            client.SetAttribute("Interval", TimeValue(Seconds(interval)));
+            client.SetAttribute("PacketSize", UintegerValue(packetSize));
+            ApplicationContainer clientApp = client.Install(apNode.Get(0));
+            clientApp.Start(Seconds(0.5));
+            clientApp.Stop(Seconds(config.time));
+        }
+    }
+
+    Simulator::Stop(Seconds(config.time));
+    Simulator::Run();
+
+    PlanResult result;
+    for (uint32_t b = 0; b < config.nBss; ++b)
+    {
+        uint64_t received = 0;
+        for (uint32_t i = 0; i < servers[b].GetN(); ++i)
+        {
+            received += DynamicCast<UdpServer>(servers[b].Get(i))->GetReceived();
+        }
+        result.goodputMbps.push_back(received * packetSize * 8.0 / (config.time - 0.5) / 1e6);
+    }
+    Simulator::Destroy();
+    return result;
+}
+
+/// Evaluate plans in forked children, at most config.jobs at a time
+std::vector<PlanResult> EvaluatePlans(const ChannelPlanConfig& config, const std::vector<ChannelPlan>& plans)
+{
+    std::vector<PlanResult> results(plans.size());
+    std::map<pid_t, std::pair<uint32_t, int>> running; // pid -> (plan index, pipe)
+    uint32_t next = 0;
+
+    while (next < plans.size() || !running.empty())
+    {
+        while (next < plans.size() && running.size() < config.jobs)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                NS_FATAL_ERROR("pipe() failed");
+            }
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                NS_FATAL_ERROR("fork() failed");
+            }
+            if (pid == 0)
+            {
+                close(fds[0]);
+                PlanResult result = EvaluatePlan(config, plans[next]);
+                ssize_t size = result.goodputMbps.size() * sizeof(double);
+                ssize_t written = write(fds[1], result.goodputMbps.data(), size);
+                close(fds[1]);
+                _exit(written == size ? 0 : 1);
+            }
+            close(fds[1]);
+            running[pid] = std::make_pair(next++, fds[0]);
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        auto it = running.find(pid);
+        if (it == running.end())
+        {
+            continue;
+        }
+        PlanResult& result = results[it->second.first];
+        result.goodputMbps.resize(config.nBss, 0.0);
+        char* buffer = reinterpret_cast<char*>(result.goodputMbps.data());
+        size_t size = config.nBss * sizeof(double);
+        size_t done = 0;
+        ssize_t n;
+        while (done < size && (n = read(it->second.second, buffer + done, size - done)) > 0)
+        {
+            done += n;
+        }
+        close(it->second.second);
+        if (done < size || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            NS_FATAL_ERROR("evaluation of plan " << PlanToString(plans[it->second.first]) << " failed");
+        }
+        running.erase(it);
+    }
+    return results;
+}
+
+void PrintPlan(const std::string& label, const ChannelPlan& plan, const PlanResult& result)
+{
+    std::cout << label << ": [" << PlanToString(plan) << "]" << std::endl;
+    std::cout << "  Débit agrégé: " << result.Aggregate() << " Mbps, pire BSS: " << result.Worst()
+              << " Mbps" << std::endl;
+    for (uint32_t b = 0; b < result.goodputMbps.size(); ++b)
+    {
+        std::cout << "  BSS " << b << " (canal " << plan[b].number << ", " << plan[b].width
+                  << " MHz): " << result.goodputMbps[b] << " Mbps" << std::endl;
+    }
+}
+
+/// Local search from the naive co-channel plan, reporting it against the best plan found
+void RunChannelPlanner(const ChannelPlanConfig& config,
+                       const std::vector<ChannelOption>& options,
+                       ResultsDb& results)
+{
+    std::map<ChannelPlan, PlanResult> evaluated;
+
+    ChannelPlan naive(config.nBss, options.front());
+    evaluated[naive] = EvaluatePlans(config, {naive}).front();
+
+    ChannelPlan best = naive;
+    uint32_t evaluations = 1;
+    for (uint32_t pass = 0; pass < config.passes; ++pass)
+    {
+        bool improved = false;
+        for (uint32_t b = 0; b < config.nBss; ++b)
+        {
+            // all single-BSS moves from the current best plan, evaluated in parallel
+            std::vector<ChannelPlan> candidates;
+            for (const ChannelOption& option : options)
+            {
+                ChannelPlan candidate = best;
+                candidate[b] = option;
+                if (evaluated.find(candidate) == evaluated.end())
+                {
+                    candidates.push_back(candidate);
+                }
+            }
+            std::vector<PlanResult> scores = EvaluatePlans(config, candidates);
+            evaluations += candidates.size();
+            for (uint32_t i = 0; i < candidates.size(); ++i)
+            {
+                evaluated[candidates[i]] = scores[i];
+                if (scores[i].Score() > evaluated[best].Score())
+                {
+                    best = candidates[i];
+                    improved = true;
+                }
+            }
+        }
+        std::cout << "Passe " << pass + 1 << ": [" << PlanToString(best) << "] "
+                  << evaluated[best].Aggregate() << " Mbps agrégés" << std::endl;
+        if (!improved)
+        {
+            break;
+        }
+    }
+
+    std::cout << "\n=== PLAN DE CANAUX (" << evaluations << " évaluations) ===" << std::endl;
+    PrintPlan("Plan naïf", naive, evaluated[naive]);
+    PrintPlan("Meilleur plan", best, evaluated[best]);
+
+    results.AddMetric("planEvaluations", evaluations);
+    results.AddMetric("naiveAggregateMbps", evaluated[naive].Aggregate());
+    results.AddMetric("naiveWorstBssMbps", evaluated[naive].Worst());
+    results.AddMetric("bestAggregateMbps", evaluated[best].Aggregate());
+    results.AddMetric("bestWorstBssMbps", evaluated[best].Worst());
+    results.AddParam("bestPlan", PlanToString(best));
+    for (uint32_t b = 0; b < config.nBss; ++b)
+    {
+        std::string bss = "bss" + std::to_string(b);
+        results.AddFlowMetric(bss, "naiveGoodputMbps", evaluated[naive].goodputMbps[b]);
+        results.AddFlowMetric(bss, "bestGoodputMbps", evaluated[best].goodputMbps[b]);
+        results.AddFlowMetric(bss, "bestChannel", best[b].number);
+        results.AddFlowMetric(bss, "bestWidth", best[b].width);
+    }
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -102,27 +611,173 @@ main(int argc, char* argv[])
     uint32_t nWifi = 4;
     uint32_t nPackets = 10;
     bool tracing = false;
+    bool oneWay = false;
+    double delayBinMs = 1.0;
+    std::string resultsDb = "tp2/results.db";
+    double airtimePeriod = 1.0;
+    std::string transport = "udp";
+    std::string tcpCc = "cubic";
+    std::string flowMonitorMode = "all";
+    uint32_t flowSampling = 1;
+    uint32_t flowTopK = 0;
+    bool channelPlan = false;
+    uint32_t nBss = 4;
+    std::string planChannels = "36,40,44,48";
+    std::string planWidths = "20,40";
+    double planSpacing = 15.0;
+    double planLoad = 40.0;
+    double planTime = 2.0;
+    uint32_t planJobs = 0;
+    uint32_t planPasses = 3;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("nWifi", "Number of wifi STA devices per network", nWifi);
     cmd.AddValue("nPackets", "Number of packets to send", nPackets);
     cmd.AddValue("verbose", "Tell echo applications to log if true", verbose);
     cmd.AddValue("tracing", "Enable pcap tracing", tracing);
+    cmd.AddValue("oneWay", "Add a SeqTs-stamped UDP flow per STA in both directions", oneWay);
+    cmd.AddValue("delayBinMs", "Width of one-way delay histogram bins in ms", delayBinMs);
+    cmd.AddValue("resultsDb", "SQLite database the run is appended to (empty = disabled)", resultsDb);
+    cmd.AddValue("airtimePeriod", "Channel utilization sampling period in seconds", airtimePeriod);
+    cmd.AddValue("transport", "Workload between the two networks: udp (echo), udpbulk (saturating UDP) or tcp (bulk transfer)", transport);
+    cmd.AddValue("tcpCc", "TCP congestion control: cubic, newreno or bbr", tcpCc);
+    cmd.AddValue("flowMonitor", "Flow monitoring: all (probes on every node) or endpoints (STAs only)", flowMonitorMode);
+    cmd.AddValue("flowSampling", "With flowMonitor=endpoints, sample one packet in N", flowSampling);
+    cmd.AddValue("flowTopK", "With flowMonitor=endpoints, track at most K heaviest flows (0 = all)", flowTopK);
+    cmd.AddValue("channelPlan", "Search a channel assignment for nBss co-located BSSes instead", channelPlan);
+    cmd.AddValue("nBss", "Number of BSSes for channelPlan", nBss);
+    cmd.AddValue("planChannels", "Comma-separated 5 GHz 20 MHz channels available to channelPlan", planChannels);
+    cmd.AddValue("planWidths", "Comma-separated channel widths (20, 40) available to channelPlan", planWidths);
+    cmd.AddValue("planSpacing", "Distance between neighbouring APs in meters for channelPlan", planSpacing);
+    cmd.AddValue("planLoad", "Offered downlink load per BSS in Mbps for channelPlan", planLoad);
+    cmd.AddValue("planTime", "Length of one channelPlan evaluation run in seconds", planTime);
+    cmd.AddValue("planJobs", "Parallel channelPlan evaluations (0 = number of cores)", planJobs);
+    cmd.AddValue("planPasses", "Maximum local search passes for channelPlan", planPasses);
 
     cmd.Parse(argc, argv);
 
+    ResultsDb results("third4", __FILE__);
+    results.AddParam("nWifi", nWifi);
+    results.AddParam("nPackets", nPackets);
+    results.AddParam("verbose", verbose);
+    results.AddParam("tracing", tracing);
+    results.AddParam("oneWay", oneWay);
+    results.AddParam("delayBinMs", delayBinMs);
+    results.AddParam("airtimePeriod", airtimePeriod);
+    results.AddParam("transport", transport);
+    results.AddParam("tcpCc", tcpCc);
+    results.AddParam("flowMonitor", flowMonitorMode);
+    results.AddParam("flowSampling", flowSampling);
+    results.AddParam("flowTopK", flowTopK);
+
     if (nWifi > 9)
     {
         std::cout << "nWifi should be 9 or less (total nodes = 2 * nWifi)" << std::endl;
         return 1;
     }
 
+    if (channelPlan)
+    {
+        std::set<uint16_t> channels;
+        std::set<uint16_t> widths;
+        std::string value;
+        std::istringstream channelList(planChannels);
+        while (std::getline(channelList, value, ','))
+        {
+            channels.insert(std::stoul(value));
+        }
+        std::istringstream widthList(planWidths);
+        while (std::getline(widthList, value, ','))
+        {
+            widths.insert(std::stoul(value));
+        }
+
+        std::vector<ChannelOption> options = ChannelOptions(channels, widths);
+        if (options.empty() || nBss == 0 || planTime <= 0.5)
+        {
+            std::cout << "channelPlan needs at least one channel option, one BSS and planTime > 0.5" << std::endl;
+            return 1;
+        }
+        if (nBss > 255)
+        {
+            // BSS b is numbered 10.10.b.0/24
+            std::cout << "nBss should be 255 or less" << std::endl;
+            return 1;
+        }
+
+        ChannelPlanConfig config;
+        config.nBss = nBss;
+        config.nSta = nWifi;
+        config.spacing = planSpacing;
+        config.loadMbps = planLoad;
+        config.time = planTime;
+        config.jobs = planJobs > 0 ? planJobs : std::max(1u, std::thread::hardware_concurrency());
+        config.passes = planPasses;
+
+        results.AddParam("channelPlan", channelPlan);
+        results.AddParam("nBss", nBss);
+        results.AddParam("planChannels", planChannels);
+        results.AddParam("planWidths", planWidths);
+        results.AddParam("planSpacing", planSpacing);
+        results.AddParam("planLoad", planLoad);
+        results.AddParam("planTime", planTime);
+        results.AddParam("planPasses", planPasses);
+
+        std::cout << "Recherche d'un plan de canaux: " << nBss << " BSS, " << options.size()
+                  << " options de canal, " << config.jobs << " évaluations en parallèle" << std::endl;
+        RunChannelPlanner(config, options, results);
+
+        if (!resultsDb.empty())
+        {
+            std::system("mkdir -p tp2");
+            if (results.Commit(resultsDb))
+            {
+                std::cout << "\nRésultats enregistrés dans " << resultsDb << " (run " << results.GetRunId() << ")" << std::endl;
+            }
+            else
+            {
+                std::cout << "\nÉchec de l'écriture des résultats dans " << resultsDb << std::endl;
+            }
+        }
+        return 0;
+    }
+
     if (nPackets > 20)
     {
         std::cout << "nPackets should be 20 or less" << std::endl;
         return 1;
     }
 
+    if (delayBinMs <= 0)
+    {
+        std::cout << "delayBinMs should be greater than 0" << std::endl;
+        return 1;
+    }
+
+    if (airtimePeriod <= 0)
+    {
+        std::cout << "airtimePeriod should be greater than 0" << std::endl;
+        return 1;
+    }
+
+    if (transport != "udp" && transport != "udpbulk" && transport != "tcp")
+    {
+        std::cout << "transport should be udp, udpbulk or tcp" << std::endl;
+        return 1;
+    }
+
+    if (flowMonitorMode != "all" && flowMonitorMode != "endpoints")
+    {
+        std::cout << "flowMonitor should be all or endpoints" << std::endl;
+        return 1;
+    }
+
+    if (!TcpBulkMonitor::Configure(tcpCc))
+    {
+        std::cout << "tcpCc should be cubic, newreno or bbr" << std::endl;
+        return 1;
+    }
+
     NodeContainer p2pNodes;
     p2pNodes.Create(2);
 
@@ -249,27 +904,112 @@ main(int argc, char* argv[])
     wifi1Interfaces = address.Assign(staDevices1);
     address.Assign(apDevices1);
 
-    UdpEchoServerHelper echoServer(9);
+    // bulk TCP, or saturating UDP as its baseline, replaces the echo exchange
+    // between the same two STAs
+    const Time bulkStart = Seconds(2.0);
+    const Time bulkStop = Seconds(20.0);
+    const uint32_t bulkPacketSize = 1448;
+    const double bulkOfferedMbps = 10.0; // twice the 5 Mbps point-to-point bottleneck
+    TcpBulkMonitor tcp(Seconds(1.0));
+    Ptr<UdpServer> udpBulkServer;
+    if (transport == "tcp")
+    {
+        tcp.Install("sta1-sta2",
+                    wifiStaNodes1.Get(nWifi - 1),
+                    wifiStaNodes2.Get(nWifi - 1),
+                    wifi2Interfaces.GetAddress(nWifi - 1),
+                    9,
+                    bulkStart,
+                    bulkStop);
+    }
+    else if (transport == "udpbulk")
+    {
+        UdpServerHelper server(9);
+        ApplicationContainer serverApps = server.Install(wifiStaNodes2.Get(nWifi - 1));
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(bulkStop);
+        udpBulkServer = DynamicCast<UdpServer>(serverApps.Get(0));
+
+        UdpClientHelper client(wifi2Interfaces.GetAddress(nWifi - 1), 9);
+        client.SetAttribute("MaxPackets", UintegerValue(0));
+        client.SetAttribute("Interval", TimeValue(Seconds(bulkPacketSize * 8.0 / (bulkOfferedMbps * 1e6))));
+        client.SetAttribute("PacketSize", UintegerValue(bulkPacketSize));
+        ApplicationContainer clientApps = client.Install(wifiStaNodes1.Get(nWifi - 1));
+        clientApps.Start(bulkStart);
+        clientApps.Stop(bulkStop);
+    }
+    else
+    {
+        UdpEchoServerHelper echoServer(9);
 
-    ApplicationContainer serverApps = echoServer.Install(wifiStaNodes2.Get(nWifi - 1));
-    serverApps.Start(Seconds(1.0));
-    serverApps.Stop(Seconds(20.0));
+        ApplicationContainer serverApps = echoServer.Install(wifiStaNodes2.Get(nWifi - 1));
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(Seconds(20.0));
 
-    UdpEchoClientHelper echoClient(wifi2Interfaces.GetAddress(nWifi - 1), 9);
-    echoClient.SetAttribute("MaxPackets", UintegerValue(nPackets));
-    echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
-    echoClient.SetAttribute("PacketSize", UintegerValue(1024));
+        UdpEchoClientHelper echoClient(wifi2Interfaces.GetAddress(nWifi - 1), 9);
+        echoClient.SetAttribute("MaxPackets", UintegerValue(nPackets));
+        echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
+        echoClient.SetAttribute("PacketSize", UintegerValue(1024));
 
-    ApplicationContainer clientApps = echoClient.Install(wifiStaNodes1.Get(nWifi - 1));
-    clientApps.Start(Seconds(2.0));
-    clientApps.Stop(Seconds(20.0));
+        ApplicationContainer clientApps = echoClient.Install(wifiStaNodes1.Get(nWifi - 1));
+        clientApps.Start(Seconds(2.0));
+        clientApps.Stop(Seconds(20.0));
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+        Ptr<UdpEchoClient> client = DynamicCast<UdpEchoClient>(clientApps.Get(0));
+        client->TraceConnectWithoutContext("Tx", MakeCallback(&ClientTxTrace));
+        client->TraceConnectWithoutContext("Rx", MakeCallback(&ClientRxTrace));
+    }
 
-    Ptr<UdpEchoClient> client = DynamicCast<UdpEchoClient>(clientApps.Get(0));
-    
-    client->TraceConnectWithoutContext("Tx", MakeCallback(&ClientTxTrace));
-    client->TraceConnectWithoutContext("Rx", MakeCallback(&ClientRxTrace));
+    if (oneWay)
+    {
+        // STA i of each network sends to STA i of the other one; UdpClient
+        // stamps a SeqTsHeader on every packet, read back by the server trace
+        const Time clientStart = Seconds(2.0);
+        const Time clientStop = Seconds(20.0);
+        const Time clientInterval = Seconds(1.0);
+        oneWayTracker.binWidth = Seconds(delayBinMs / 1000.0);
+
+        // a client sends at start + k * interval until it stops (a send due at
+        // the stop time is cancelled) or has sent MaxPackets (0 = unlimited)
+        uint64_t window = (clientStop - clientStart).GetNanoSeconds();
+        uint64_t step = clientInterval.GetNanoSeconds();
+        uint32_t sends = (window + step - 1) / step;
+        oneWayTracker.sentPerFlow = nPackets > 0 ? std::min(nPackets, sends) : sends;
+
+        for (uint32_t i = 0; i < nWifi; ++i)
+        {
+            uint16_t port12 = 4000 + i;
+            uint16_t port21 = 5000 + i;
+
+            UdpServerHelper server12(port12);
+            ApplicationContainer sink12 = server12.Install(wifiStaNodes2.Get(i));
+            UdpServerHelper server21(port21);
+            ApplicationContainer sink21 = server21.Install(wifiStaNodes1.Get(i));
+            sink12.Add(sink21);
+            sink12.Start(Seconds(1.0));
+            sink12.Stop(Seconds(20.0));
+            for (uint32_t j = 0; j < sink12.GetN(); ++j)
+            {
+                sink12.Get(j)->TraceConnectWithoutContext("RxWithAddresses",
+                                                          MakeCallback(&ServerRxTrace));
+            }
+
+            UdpClientHelper client12(wifi2Interfaces.GetAddress(i), port12);
+            UdpClientHelper client21(wifi1Interfaces.GetAddress(i), port21);
+            for (UdpClientHelper* helper : {&client12, &client21})
+            {
+                helper->SetAttribute("MaxPackets", UintegerValue(nPackets));
+                helper->SetAttribute("Interval", TimeValue(clientInterval));
+                helper->SetAttribute("PacketSize", UintegerValue(1024));
+            }
+            ApplicationContainer sources = client12.Install(wifiStaNodes1.Get(i));
+            sources.Add(client21.Install(wifiStaNodes2.Get(i)));
+            sources.Start(clientStart);
+            sources.Stop(clientStop);
+        }
+    }
+
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
     std::system("mkdir -p tp2");
     AnimationInterface anim("tp2/anim1.xml");
@@ -286,7 +1026,26 @@ main(int argc, char* argv[])
     anim.UpdateNodeColor(wifiApNode2.Get(0)->GetId(), 0, 128, 255);
 
     FlowMonitorHelper flowMonitor;
-    Ptr<FlowMonitor> monitor = flowMonitor.InstallAll();
+    Ptr<FlowMonitor> monitor;
+    SampledFlowMonitor sampledMonitor(flowSampling, flowTopK);
+    FlowProbeCounter probeCounter;
+    if (flowMonitorMode == "all")
+    {
+        monitor = flowMonitor.InstallAll();
+        probeCounter.Install(NodeContainer::GetGlobal());
+    }
+    else
+    {
+        // every flow starts and ends on a STA; the APs only forward
+        sampledMonitor.Install(wifiStaNodes1);
+        sampledMonitor.Install(wifiStaNodes2);
+    }
+
+    AirtimeMonitor airtime(Seconds(airtimePeriod));
+    airtime.AddDevices(apDevices1, "ap1", "bss1", true);
+    airtime.AddDevices(staDevices1, "sta1", "bss1", false);
+    airtime.AddDevices(apDevices2, "ap2", "bss2", true);
+    airtime.AddDevices(staDevices2, "sta2", "bss2", false);
 
     Simulator::Stop(Seconds(20.0));
 
@@ -327,7 +1086,10 @@ main(int argc, char* argv[])
     std::cout << "Démarrage de la simulation..." << std::endl;
     std::cout << "Configuration: " << nWifi << " STA par réseau, " << nPackets << " paquets" << std::endl;
 
+    auto runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    double runWallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
 
     clientTracker.ExportDelays("tp2/client_delays.csv");
 
@@ -338,18 +1100,47 @@ main(int argc, char* argv[])
     std::cout << "Génération des graphiques..." << std::endl;
     std::cout << "Exécutez: python3 tp2/plot_delays.py pour générer les graphiques" << std::endl;
 
-    monitor->CheckForLostPackets();
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+    FlowMonitor::FlowStatsContainer stats;
+    std::map<FlowId, Ipv4FlowClassifier::FiveTuple> tuples;
+    if (monitor)
+    {
+        monitor->CheckForLostPackets();
+        stats = monitor->GetFlowStats();
+        Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowMonitor.GetClassifier());
+        for (auto it = stats.begin(); it != stats.end(); ++it)
+        {
+            tuples[it->first] = classifier->FindFlow(it->first);
+        }
+    }
+    else
+    {
+        stats = sampledMonitor.GetFlowStats();
+        tuples = sampledMonitor.GetFlowTuples();
+    }
 
     std::cout << "\n=== STATISTIQUES FLOW MONITOR ===" << std::endl;
+    if (!monitor)
+    {
+        sampledMonitor.PrintStats(std::cout);
+    }
     for (auto it = stats.begin(); it != stats.end(); ++it)
     {
+        const Ipv4FlowClassifier::FiveTuple& tuple = tuples[it->first];
+        std::ostringstream flow;
+        flow << tuple.sourceAddress << ":" << tuple.sourcePort << "->" << tuple.destinationAddress
+             << ":" << tuple.destinationPort;
+        results.AddFlowMetric(flow.str(), "txPackets", it->second.txPackets);
+        results.AddFlowMetric(flow.str(), "rxPackets", it->second.rxPackets);
+        results.AddFlowMetric(flow.str(), "lostPackets", it->second.lostPackets);
+
         std::cout << "Flow " << it->first << ":" << std::endl;
         std::cout << "  Tx Packets: " << it->second.txPackets << std::endl;
         std::cout << "  Rx Packets: " << it->second.rxPackets << std::endl;
         std::cout << "  Lost Packets: " << it->second.lostPackets << std::endl;
         if (it->second.rxPackets > 0)
         {
+            results.AddFlowMetric(flow.str(), "meanDelayMs", it->second.delaySum.GetSeconds() * 1000.0 / it->second.rxPackets);
+            results.AddFlowMetric(flow.str(), "throughputKbps", it->second.rxBytes * 8.0 / (it->second.timeLastRxPacket - it->second.timeFirstTxPacket).GetSeconds() / 1000.0);
             std::cout << "  Mean Delay: " << it->second.delaySum.GetMilliSeconds() / it->second.rxPackets << " ms" << std::endl;
             std::cout << "  Throughput: " << it->second.rxBytes * 8.0 / (it->second.timeLastRxPacket - it->second.timeFirstTxPacket).GetSeconds() / 1000.0 << " kbps" << std::endl;
         }
@@ -374,12 +1165,107 @@ main(int argc, char* argv[])
         std::cout << "Délai minimum: " << minDelay << " ms" << std::endl;
         std::cout << "Délai maximum: " << maxDelay << " ms" << std::endl;
         std::cout << "Nombre de paquets mesurés: " << clientTracker.delays.size() << std::endl;
+
+        results.AddMetric("echoMeanDelayMs", totalDelay / clientTracker.delays.size());
+        results.AddMetric("echoMinDelayMs", minDelay);
+        results.AddMetric("echoMaxDelayMs", maxDelay);
+        results.AddMetric("echoPackets", clientTracker.delays.size());
+        for (uint32_t i = 0; i < clientTracker.delays.size(); ++i)
+        {
+            results.AddSample("echoDelayMs", i + 1, clientTracker.delays[i].second.GetSeconds() * 1000.0);
+        }
+    }
+
+    if (oneWay)
+    {
+        oneWayTracker.ExportFlows("tp2/flow_delays.csv");
+        oneWayTracker.ExportHistograms("tp2/flow_delay_hist.csv");
+
+        std::cout << "\n=== DÉLAIS UNIDIRECTIONNELS PAR FLUX ===" << std::endl;
+        for (const auto& entry : oneWayTracker.flows)
+        {
+            const OneWayDelayTracker::FlowStats& flow = entry.second;
+            std::cout << Ipv4Address(std::get<0>(entry.first)) << ":" << std::get<1>(entry.first)
+                      << " -> port " << std::get<2>(entry.first) << std::endl;
+            std::cout << "  Reçus: " << flow.received << ", perdus: " << oneWayTracker.Lost(flow)
+                      << ", déséquencés: " << flow.reordered << std::endl;
+            std::cout << "  Délai moyen: " << flow.delaySum.GetSeconds() * 1000.0 / flow.received
+                      << " ms, P95: " << oneWayTracker.Quantile(flow, 0.95).GetSeconds() * 1000.0
+                      << " ms, gigue: " << flow.jitterMs << " ms" << std::endl;
+
+            std::ostringstream label;
+            label << "oneway:" << Ipv4Address(std::get<0>(entry.first)) << ":"
+                  << std::get<1>(entry.first) << "->" << std::get<2>(entry.first);
+            results.AddFlowMetric(label.str(), "received", flow.received);
+            results.AddFlowMetric(label.str(), "lost", oneWayTracker.Lost(flow));
+            results.AddFlowMetric(label.str(), "reordered", flow.reordered);
+            results.AddFlowMetric(label.str(), "meanDelayMs", flow.delaySum.GetSeconds() * 1000.0 / flow.received);
+            results.AddFlowMetric(label.str(), "p95DelayMs", oneWayTracker.Quantile(flow, 0.95).GetSeconds() * 1000.0);
+            results.AddFlowMetric(label.str(), "jitterMs", flow.jitterMs);
+        }
+    }
+
+    // the echo workload is nPackets requests, far from saturating: only the bulk
+    // modes have a goodput, and TCP is compared with the saturating UDP run
+    if (transport != "udp")
+    {
+        double goodput = transport == "tcp"
+                             ? tcp.GoodputMbps()
+                             : udpBulkServer->GetReceived() * bulkPacketSize * 8.0 /
+                                   (bulkStop - bulkStart).GetSeconds() / 1e6;
+        results.AddMetric("goodputMbps", goodput);
+        std::cout << "\nDébit utile applicatif (" << transport << "): " << goodput << " Mbps" << std::endl;
+    }
+
+    if (transport == "tcp")
+    {
+        tcp.Report(std::cout);
+        tcp.Export("tp2/third4-tcp.csv");
+        tcp.Record(results);
+        results.CompareWithRun(resultsDb, "transport", "udpbulk", "goodputMbps", tcp.GoodputMbps(),
+                               "tcpUdpGoodputRatio", "Ratio TCP/UDP", std::cout);
+    }
+
+    // cost of this monitoring mode against InstallAll(): probe events are
+    // deterministic; wall time also carries animation and tracing, so it is
+    // only indicative
+    uint64_t probeEvents = monitor ? probeCounter.GetEvents() : sampledMonitor.GetProbeEvents();
+    results.AddMetric("flowProbeEvents", probeEvents);
+    results.AddMetric("runWallSeconds", runWallSeconds);
+    std::cout << "\nÉvénements de sonde IPv4: " << probeEvents << std::endl;
+    std::cout << "Temps d'exécution de la simulation: " << runWallSeconds << " s" << std::endl;
+    if (!monitor)
+    {
+        results.CompareWithRun(resultsDb, "flowMonitor", "all", "flowProbeEvents", probeEvents,
+                               "flowMonitorCostRatio", "  Événements de sonde / InstallAll()", std::cout);
+        results.CompareWithRun(resultsDb, "flowMonitor", "all", "runWallSeconds", runWallSeconds,
+                               "flowMonitorWallRatio", "  Temps d'exécution / InstallAll() (indicatif)", std::cout);
+    }
+
+    airtime.Report(std::cout);
+    airtime.ExportSamples("tp2/airtime.csv");
+    airtime.Record(results);
+
+    if (!resultsDb.empty())
+    {
+        if (results.Commit(resultsDb))
+        {
+            std::cout << "\nRésultats enregistrés dans " << resultsDb << " (run " << results.GetRunId() << ")" << std::endl;
+        }
+        else
+        {
+            std::cout << "\nÉchec de l'écriture des résultats dans " << resultsDb << std::endl;
+        }
     }
 
     Simulator::Destroy();
     
     std::cout << "\n=== SIMULATION TERMINÉE ===" << std::endl;
     std::cout << "Données des délais: tp2/client_delays.csv" << std::endl;
+    if (oneWay)
+    {
+        std::cout << "Délais unidirectionnels: tp2/flow_delays.csv, tp2/flow_delay_hist.csv" << std::endl;
+    }
     std::cout << "Exécutez: python3 tp2/plot_delays.py pour les graphiques" << std::endl;
     
     return 0;
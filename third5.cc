@@ -6,12 +6,170 @@
 #include "ns3/wifi-module.h"
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/netanim-module.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "airtime-monitor.h"
+#include "cached-propagation-loss-model.h"
+#include "results-db.h"
+#include "sampled-flow-monitor.h"
+#include "tcp-bulk-monitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("MimoAnalysis");
 
+/**
+ * Suivi du débit utile et des pertes par fenêtre, avec détection du régime
+ * stationnaire : le transitoire initial est tronqué par MSER, puis un
+ * intervalle de confiance par moyennes de lots (10 lots) est calculé sur le
+ * reste. En mode adaptatif, la simulation est arrêtée dès que la demi-largeur
+ * relative de l'intervalle passe sous la précision demandée.
+ */
+class SteadyStateDetector
+{
+public:
+    static const uint32_t BATCHES = 10;
+    static constexpr double T_QUANTILE = 2.262; // t(0.975, BATCHES - 1)
+
+    SteadyStateDetector(Ptr<UdpServer> server, Time window, double precision, bool adaptive)
+        : m_server(server), m_window(window), m_precision(precision), m_adaptive(adaptive) {}
+
+    void Start(Time start, Time end) {
+        m_end = end;
+        Simulator::Schedule(start - Simulator::Now(), &SteadyStateDetector::Sample, this);
+    }
+
+    void Rx(Ptr<const Packet> packet) {
+        m_rxBytes += packet->GetSize();
+    }
+
+    void RxFrom(Ptr<const Packet> packet, const Address& from) {
+        Rx(packet);
+    }
+
+    uint64_t RxBytes() const { return m_rxBytes; }
+
+    bool Converged() const { return m_converged; }
+    uint32_t Truncation() const { return m_truncation; }
+    Time TruncationTime() const { return m_start + m_window * m_truncation; }
+    uint32_t EffectiveSamples() const { return m_goodput.size() - m_truncation; }
+    double SteadyGoodput() const { return m_mean; }
+    double HalfWidth() const { return m_halfWidth; }
+    const std::vector<double>& Goodput() const { return m_goodput; }
+    const std::vector<double>& Loss() const { return m_loss; }
+    Time GetWindow() const { return m_window; }
+
+private:
+    void Sample() {
+        if (!m_started) {
+            m_started = true;
+            m_start = Simulator::Now();
+        } else {
+            // sans UdpServer (flux TCP), pas de compteur de pertes
+            uint64_t received = m_server ? m_server->GetReceived() : 0;
+            uint32_t lost = m_server ? m_server->GetLost() : 0;
+            uint64_t dReceived = received - m_lastReceived;
+            uint32_t dLost = lost - m_lastLost;
+
+            m_goodput.push_back((m_rxBytes - m_lastBytes) * 8.0 / m_window.GetSeconds() / 1e6);
+            m_loss.push_back((dReceived + dLost) > 0 ? dLost * 100.0 / (dReceived + dLost) : 0.0);
+
+            if (Update() && m_adaptive) {
+                m_converged = true;
+                Simulator::Stop();
+                return;
+            }
+        }
+        m_lastBytes = m_rxBytes;
+        m_lastReceived = m_server ? m_server->GetReceived() : 0;
+        m_lastLost = m_server ? m_server->GetLost() : 0;
+        if (Simulator::Now() + m_window <= m_end) {
+            Simulator::Schedule(m_window, &SteadyStateDetector::Sample, this);
+        }
+    }
+
+    // MSER : point de troncature d minimisant la variance de la moyenne des
+    // échantillons restants, cherché sur la première moitié de la série
+    uint32_t Mser() const {
+        uint32_t n = m_goodput.size();
+        std::vector<double> sum(n + 1, 0.0);
+        std::vector<double> sumSq(n + 1, 0.0);
+        for (uint32_t i = n; i > 0; --i) {
+            sum[i - 1] = sum[i] + m_goodput[i - 1];
+            sumSq[i - 1] = sumSq[i] + m_goodput[i - 1] * m_goodput[i - 1];
+        }
+
+        uint32_t best = 0;
+        double bestValue = std::numeric_limits<double>::max();
+        for (uint32_t d = 0; d <= n / 2; ++d) {
+            double m = n - d;
+            double mean = sum[d] / m;
+            double value = (sumSq[d] - m * mean * mean) / (m * m);
+            if (value < bestValue) {
+                bestValue = value;
+                best = d;
+            }
+        }
+        return best;
+    }
+
+    // Recalcule troncature et intervalle de confiance ; vrai si la précision est atteinte
+    bool Update() {
+        m_truncation = Mser();
+        uint32_t batchSize = EffectiveSamples() / BATCHES;
+        if (batchSize < 2) {
+            m_mean = 0.0;
+            m_halfWidth = 0.0;
+            return false;
+        }
+
+        // les lots sont pris à la fin de la série, les échantillons en trop juste après la troncature sont ignorés
+        uint32_t first = m_goodput.size() - batchSize * BATCHES;
+        std::vector<double> batchMeans(BATCHES, 0.0);
+        for (uint32_t i = first; i < m_goodput.size(); ++i) {
+            batchMeans[(i - first) / batchSize] += m_goodput[i] / batchSize;
+        }
+
+        double mean = 0.0;
+        for (double b : batchMeans) {
+            mean += b / BATCHES;
+        }
+        double variance = 0.0;
+        for (double b : batchMeans) {
+            variance += (b - mean) * (b - mean) / (BATCHES - 1);
+        }
+        m_mean = mean;
+        m_halfWidth = T_QUANTILE * std::sqrt(variance / BATCHES);
+        return mean > 0 && m_halfWidth / mean <= m_precision;
+    }
+
+    Ptr<UdpServer> m_server;
+    Time m_window;
+    double m_precision;
+    bool m_adaptive;
+
+    bool m_started = false;
+    Time m_start;
+    Time m_end;
+    uint64_t m_rxBytes = 0;
+    uint64_t m_lastBytes = 0;
+    uint64_t m_lastReceived = 0;
+    uint32_t m_lastLost = 0;
+    std::vector<double> m_goodput;
+    std::vector<double> m_loss;
+
+    uint32_t m_truncation = 0;
+    double m_mean = 0.0;
+    double m_halfWidth = 0.0;
+    bool m_converged = false;
+};
+
 int main(int argc, char *argv[])
 {
     uint32_t spatialStreams = 1;
@@ -19,6 +177,17 @@ int main(int argc, char *argv[])
     bool enableAnimation = false;
     double distance = 10.0;
     uint32_t channelWidth = 20; // Default: 20 MHz
+    std::string resultsDb = "tp2/results.db";
+    bool adaptive = false;
+    double window = 0.1;
+    double precision = 0.02;
+    bool lossCache = true;
+    double airtimePeriod = 0.5;
+    std::string transport = "udp";
+    std::string tcpCc = "cubic";
+    std::string flowMonitorMode = "all";
+    uint32_t flowSampling = 1;
+    uint32_t flowTopK = 0;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("spatialStreams", "Number of spatial streams (1 or 2)", spatialStreams);
@@ -26,14 +195,68 @@ int main(int argc, char *argv[])
     cmd.AddValue("animation", "Enable NetAnim", enableAnimation);
     cmd.AddValue("distance", "Distance between STA and AP in meters", distance);
     cmd.AddValue("channelWidth", "Channel width in MHz (20 or 40)", channelWidth);
+    cmd.AddValue("resultsDb", "SQLite database the run is appended to (empty = disabled)", resultsDb);
+    cmd.AddValue("adaptive", "Stop once steady-state goodput is known within the precision", adaptive);
+    cmd.AddValue("window", "Goodput/loss sampling window in seconds", window);
+    cmd.AddValue("precision", "Target relative half-width of the 95% goodput confidence interval", precision);
+    cmd.AddValue("lossCache", "Cache the log-distance path loss of static links", lossCache);
+    cmd.AddValue("airtimePeriod", "Channel utilization sampling period in seconds", airtimePeriod);
+    cmd.AddValue("transport", "Workload: udp (constant bit rate), udpbulk (saturating UDP) or tcp (bulk transfer)", transport);
+    cmd.AddValue("tcpCc", "TCP congestion control: cubic, newreno or bbr", tcpCc);
+    cmd.AddValue("flowMonitor", "Flow monitoring: all (FlowMonitor on every node) or endpoints", flowMonitorMode);
+    cmd.AddValue("flowSampling", "With flowMonitor=endpoints, sample one packet in N", flowSampling);
+    cmd.AddValue("flowTopK", "With flowMonitor=endpoints, track at most K heaviest flows (0 = all)", flowTopK);
     cmd.Parse(argc, argv);
 
+    if (transport != "udp" && transport != "udpbulk" && transport != "tcp") {
+        std::cout << "ERROR: transport must be udp, udpbulk or tcp." << std::endl;
+        return 1;
+    }
+    if (!TcpBulkMonitor::Configure(tcpCc)) {
+        std::cout << "ERROR: tcpCc must be cubic, newreno or bbr." << std::endl;
+        return 1;
+    }
+    if (flowMonitorMode != "all" && flowMonitorMode != "endpoints") {
+        std::cout << "ERROR: flowMonitor must be all or endpoints." << std::endl;
+        return 1;
+    }
+    // the goodput sampler (and the TCP sampler) reschedule themselves every window
+    if (window <= 0) {
+        std::cout << "ERROR: window must be greater than 0." << std::endl;
+        return 1;
+    }
+    if (precision <= 0) {
+        std::cout << "ERROR: precision must be greater than 0." << std::endl;
+        return 1;
+    }
+    if (airtimePeriod <= 0) {
+        std::cout << "ERROR: airtimePeriod must be greater than 0." << std::endl;
+        return 1;
+    }
+
     // Validate channel width
     if (channelWidth != 20 && channelWidth != 40) {
         std::cout << "ERROR: Channel width must be 20 or 40 MHz. Using default 20 MHz." << std::endl;
         channelWidth = 20;
     }
 
+    ResultsDb results("third5", __FILE__);
+    results.AddParam("spatialStreams", spatialStreams);
+    results.AddParam("time", simulationTime);
+    results.AddParam("animation", enableAnimation);
+    results.AddParam("distance", distance);
+    results.AddParam("channelWidth", channelWidth);
+    results.AddParam("adaptive", adaptive);
+    results.AddParam("window", window);
+    results.AddParam("precision", precision);
+    results.AddParam("lossCache", lossCache);
+    results.AddParam("airtimePeriod", airtimePeriod);
+    results.AddParam("transport", transport);
+    results.AddParam("tcpCc", tcpCc);
+    results.AddParam("flowMonitor", flowMonitorMode);
+    results.AddParam("flowSampling", flowSampling);
+    results.AddParam("flowTopK", flowTopK);
+
     std::cout << "=== ANALYSE MIMO 802.11n ===" << std::endl;
     std::cout << "Flux spatiaux: " << spatialStreams << std::endl;
     std::cout << "Distance STA-AP: " << distance << " m" << std::endl;
@@ -46,19 +269,31 @@ int main(int argc, char *argv[])
     wifiApNode.Create(1);
 
     // Configuration WiFi avec modèle de perte réaliste
-    YansWifiChannelHelper channel;
-    channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-    
+    Ptr<YansWifiChannel> wifiChannel = CreateObject<YansWifiChannel>();
+    wifiChannel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+
     // Modèle de perte réaliste avec shadowing
-    channel.AddPropagationLoss("ns3::LogDistancePropagationLossModel",
-                              "Exponent", DoubleValue(3.5),
-                              "ReferenceLoss", DoubleValue(40.0));
-    
-    // Ajouter un modèle de fading
-    channel.AddPropagationLoss("ns3::NakagamiPropagationLossModel");
+    Ptr<LogDistancePropagationLossModel> logDistance = CreateObject<LogDistancePropagationLossModel>();
+    logDistance->SetAttribute("Exponent", DoubleValue(3.5));
+    logDistance->SetAttribute("ReferenceLoss", DoubleValue(40.0));
+
+    // Ajouter un modèle de fading, toujours tiré à chaque trame
+    Ptr<NakagamiPropagationLossModel> nakagami = CreateObject<NakagamiPropagationLossModel>();
+
+    // Les nœuds sont fixes : la perte log-distance de chaque lien est mise en cache
+    Ptr<CachedPropagationLossModel> lossModelCache;
+    if (lossCache) {
+        lossModelCache = CreateObject<CachedPropagationLossModel>();
+        lossModelCache->SetModel(logDistance);
+        lossModelCache->SetNext(nakagami);
+        wifiChannel->SetPropagationLossModel(lossModelCache);
+    } else {
+        logDistance->SetNext(nakagami);
+        wifiChannel->SetPropagationLossModel(logDistance);
+    }
 
     YansWifiPhyHelper phy;
-    phy.SetChannel(channel.Create());
+    phy.SetChannel(wifiChannel);
     
     // Configuration réaliste de la puissance
     phy.Set("TxPowerStart", DoubleValue(20.0));
@@ -118,13 +353,7 @@ int main(int argc, char *argv[])
 
     // Configuration des applications
     uint16_t port = 5000;
-    UdpServerHelper server(port);
-    ApplicationContainer serverApp = server.Install(wifiApNode.Get(0));
-    serverApp.Start(Seconds(0.0));
-    serverApp.Stop(Seconds(simulationTime));
 
-    UdpClientHelper client(apInterface.GetAddress(0), port);
-    
     // CALCUL DU DÉBIT APPROPRIÉ - AJUSTÉ POUR CHANNEL BONDING
     double targetDataRate;
     if (channelWidth == 40) {
@@ -151,17 +380,38 @@ int main(int argc, char *argv[])
         }
     }
     
+    // udpbulk offre le débit PHY HT maximal de la configuration (MCS 7 par flux,
+    // GI long) : le lien, et non la charge offerte, limite alors le débit utile,
+    // ce qui en fait la référence UDP du mode tcp
+    double phyMaxRate = (channelWidth == 40 ? 135.0 : 65.0) * spatialStreams;
+    double offeredLoad = transport == "udpbulk" ? phyMaxRate : targetDataRate;
+
     // Conversion du débit en intervalle entre paquets
     uint32_t packetSize = 1470; // bytes
-    double interval = (packetSize * 8.0) / (targetDataRate * 1e6);
-    
-    client.SetAttribute("MaxPackets", UintegerValue(1000000));
-    client.SetAttribute("Interval", TimeValue(Seconds(interval)));
-    client.SetAttribute("PacketSize", UintegerValue(packetSize));
+    double interval = (packetSize * 8.0) / (offeredLoad * 1e6);
     
-    ApplicationContainer clientApp = client.Install(wifiStaNode.Get(0));
-    clientApp.Start(Seconds(1.0));
-    clientApp.Stop(Seconds(simulationTime - 1.0));
+    ApplicationContainer serverApp;
+    TcpBulkMonitor tcp(Seconds(window));
+    if (transport != "tcp") {
+        UdpServerHelper server(port);
+        serverApp = server.Install(wifiApNode.Get(0));
+        serverApp.Start(Seconds(0.0));
+        serverApp.Stop(Seconds(simulationTime));
+
+        UdpClientHelper client(apInterface.GetAddress(0), port);
+        client.SetAttribute("MaxPackets", UintegerValue(1000000));
+        client.SetAttribute("Interval", TimeValue(Seconds(interval)));
+        client.SetAttribute("PacketSize", UintegerValue(packetSize));
+
+        ApplicationContainer clientApp = client.Install(wifiStaNode.Get(0));
+        clientApp.Start(Seconds(1.0));
+        clientApp.Stop(Seconds(simulationTime - 1.0));
+    } else {
+        // Transfert TCP saturant STA -> AP sur la même fenêtre que le client UDP
+        serverApp = tcp.Install("sta-ap", wifiStaNode.Get(0), wifiApNode.Get(0),
+                                apInterface.GetAddress(0), port,
+                                Seconds(1.0), Seconds(simulationTime - 1.0));
+    }
 
     // Animation optionnelle
     if (enableAnimation) {
@@ -172,14 +422,52 @@ int main(int argc, char *argv[])
 
     // Métriques avec FlowMonitor
     FlowMonitorHelper flowMonitor;
-    Ptr<FlowMonitor> monitor = flowMonitor.InstallAll();
+    Ptr<FlowMonitor> monitor;
+    SampledFlowMonitor sampledMonitor(flowSampling, flowTopK);
+    FlowProbeCounter probeCounter;
+    if (flowMonitorMode == "all") {
+        monitor = flowMonitor.InstallAll();
+        probeCounter.Install(NodeContainer::GetGlobal());
+    } else {
+        // la STA et l'AP sont ici les deux extrémités du flux
+        sampledMonitor.Install(wifiStaNode);
+        sampledMonitor.Install(wifiApNode);
+    }
+
+    // Occupation du canal (TX, RX, CCA) et retransmissions
+    AirtimeMonitor airtime(Seconds(airtimePeriod));
+    airtime.AddDevices(apDevice, "ap", "bss", true);
+    airtime.AddDevices(staDevice, "sta", "bss", false);
+
+    // Suivi du régime stationnaire pendant l'émission du client
+    SteadyStateDetector detector(DynamicCast<UdpServer>(serverApp.Get(0)), Seconds(window), precision, adaptive);
+    if (transport != "tcp") {
+        serverApp.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&SteadyStateDetector::Rx, &detector));
+    } else {
+        serverApp.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&SteadyStateDetector::RxFrom, &detector));
+    }
+    detector.Start(Seconds(1.0), Seconds(simulationTime - 1.0));
 
     Simulator::Stop(Seconds(simulationTime));
+    auto runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    double runWallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    Time stopTime = Simulator::Now();
 
     // Analyse des résultats
-    monitor->CheckForLostPackets();
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+    FlowMonitor::FlowStatsContainer stats;
+    std::map<FlowId, Ipv4FlowClassifier::FiveTuple> tuples;
+    if (monitor) {
+        monitor->CheckForLostPackets();
+        stats = monitor->GetFlowStats();
+        Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowMonitor.GetClassifier());
+        for (auto it = stats.begin(); it != stats.end(); ++it) {
+            tuples[it->first] = classifier->FindFlow(it->first);
+        }
+    } else {
+        stats = sampledMonitor.GetFlowStats();
+        tuples = sampledMonitor.GetFlowTuples();
+    }
     
     double throughput = 0.0;
     double packetLoss = 100.0;
@@ -189,6 +477,17 @@ int main(int argc, char *argv[])
     
     for (auto it = stats.begin(); it != stats.end(); ++it) {
         auto flowStats = it->second;
+        const Ipv4FlowClassifier::FiveTuple& tuple = tuples[it->first];
+        std::ostringstream flow;
+        flow << tuple.sourceAddress << ":" << tuple.sourcePort << "->"
+             << tuple.destinationAddress << ":" << tuple.destinationPort;
+        results.AddFlowMetric(flow.str(), "txPackets", flowStats.txPackets);
+        results.AddFlowMetric(flow.str(), "rxPackets", flowStats.rxPackets);
+        results.AddFlowMetric(flow.str(), "lostPackets", flowStats.lostPackets);
+        results.AddFlowMetric(flow.str(), "rxBytes", flowStats.rxBytes);
+        if (tuple.destinationPort != port) {
+            continue; // ACKs du flux TCP
+        }
         totalRxPackets += flowStats.rxPackets;
         totalTxPackets += flowStats.txPackets;
         totalRxBytes += flowStats.rxBytes;
@@ -259,6 +558,102 @@ int main(int argc, char *argv[])
         std::cout << "📈 Gain MIMO: " << gain << "% d'efficacité" << std::endl;
     }
 
+    // Débit utile applicatif sur la fenêtre d'émission, comparable entre UDP et TCP
+    double activeTime = std::min(stopTime, Seconds(simulationTime - 1.0)).GetSeconds() - 1.0;
+    double goodput = activeTime > 0 ? detector.RxBytes() * 8.0 / activeTime / 1e6 : 0.0;
+    std::cout << "Débit utile applicatif (" << transport << "): " << goodput << " Mbps" << std::endl;
+    if (transport != "tcp") {
+        std::cout << "Charge UDP offerte: " << offeredLoad << " Mbps"
+                  << (transport == "udp" ? " (débit limité par la charge offerte, référence TCP: udpbulk)" : " (saturante)")
+                  << std::endl;
+    }
+
+    if (transport == "tcp") {
+        tcp.Report(std::cout);
+        std::system("mkdir -p tp2");
+        tcp.Export("tp2/third5-tcp.csv");
+
+        results.CompareWithRun(resultsDb, "transport", "udpbulk", "goodputMbps", goodput,
+                               "tcpUdpGoodputRatio", "Ratio TCP/UDP", std::cout);
+    }
+
+    // Coût de ce mode de suivi des flux, comparé à InstallAll() : le nombre
+    // d'événements de sonde est déterministe, le temps d'exécution indicatif
+    uint64_t probeEvents = monitor ? probeCounter.GetEvents() : sampledMonitor.GetProbeEvents();
+    std::cout << "Événements de sonde IPv4: " << probeEvents << std::endl;
+    std::cout << "Temps d'exécution de la simulation: " << runWallSeconds << " s" << std::endl;
+    if (!monitor) {
+        sampledMonitor.PrintStats(std::cout);
+
+        results.CompareWithRun(resultsDb, "flowMonitor", "all", "flowProbeEvents", probeEvents,
+                               "flowMonitorCostRatio", "  Événements de sonde / InstallAll()", std::cout);
+        results.CompareWithRun(resultsDb, "flowMonitor", "all", "runWallSeconds", runWallSeconds,
+                               "flowMonitorWallRatio", "  Temps d'exécution / InstallAll() (indicatif)", std::cout);
+    }
+
+    // Régime stationnaire
+    std::cout << "\n=== RÉGIME STATIONNAIRE ===" << std::endl;
+    std::cout << "Fin de simulation: " << stopTime.GetSeconds() << " s"
+              << (detector.Converged() ? " (arrêt adaptatif)" : "") << std::endl;
+    std::cout << "Point de troncature: " << detector.TruncationTime().GetSeconds() << " s ("
+              << detector.Truncation() << " fenêtres écartées)" << std::endl;
+    std::cout << "Échantillons effectifs: " << detector.EffectiveSamples() << " fenêtres de "
+              << window * 1000 << " ms" << std::endl;
+    if (detector.SteadyGoodput() > 0) {
+        std::cout << "Débit stationnaire: " << detector.SteadyGoodput() << " ± "
+                  << detector.HalfWidth() << " Mbps (IC 95%)" << std::endl;
+    }
+
+    airtime.Report(std::cout);
+    for (const AirtimeMonitor::Device* device : airtime.GetDevices()) {
+        if (device->dataMpdus > 0) {
+            // part de l'émission consacrée aux retransmissions
+            std::cout << "  " << device->name << ": ~"
+                      << airtime.Fraction(device, AirtimeMonitor::AIRTIME_TX) * airtime.RetryRatio(device) * 100
+                      << "% du temps en retransmissions" << std::endl;
+        }
+    }
+
+    if (lossModelCache) {
+        std::cout << std::endl;
+        lossModelCache->PrintStats(std::cout);
+    }
+
+    // Enregistrement du run dans la base de résultats
+    if (!resultsDb.empty()) {
+        results.AddMetric("targetDataRateMbps", targetDataRate);
+        results.AddMetric("offeredLoadMbps", transport == "tcp" ? 0.0 : offeredLoad);
+        results.AddMetric("theoreticalThroughputMbps", theoreticalThroughput);
+        results.AddMetric("throughputMbps", throughput);
+        results.AddMetric("efficiencyPercent", efficiency);
+        results.AddMetric("rxPackets", totalRxPackets);
+        results.AddMetric("txPackets", totalTxPackets);
+        results.AddMetric("rxBytes", totalRxBytes);
+        results.AddMetric("packetLossPercent", packetLoss);
+        results.AddMetric("goodputMbps", goodput);
+        results.AddMetric("runWallSeconds", runWallSeconds);
+        results.AddMetric("flowProbeEvents", probeEvents);
+        results.AddMetric("stopTimeSeconds", stopTime.GetSeconds());
+        results.AddMetric("truncationSeconds", detector.TruncationTime().GetSeconds());
+        results.AddMetric("effectiveSamples", detector.EffectiveSamples());
+        results.AddMetric("steadyGoodputMbps", detector.SteadyGoodput());
+        results.AddMetric("steadyGoodputHalfWidthMbps", detector.HalfWidth());
+        airtime.Record(results);
+        tcp.Record(results);
+        for (uint32_t i = 0; i < detector.Goodput().size(); ++i) {
+            double t = 1.0 + (i + 1) * window;
+            results.AddSample("goodputMbps", t, detector.Goodput()[i]);
+            results.AddSample("lossPercent", t, detector.Loss()[i]);
+        }
+
+        std::system("mkdir -p tp2");
+        if (results.Commit(resultsDb)) {
+            std::cout << "Résultats enregistrés dans " << resultsDb << " (run " << results.GetRunId() << ")" << std::endl;
+        } else {
+            std::cout << "Échec de l'écriture des résultats dans " << resultsDb << std::endl;
+        }
+    }
+
     Simulator::Destroy();
     return 0;
 }
\ No newline at end of file